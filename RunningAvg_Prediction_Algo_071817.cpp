@@ -10,6 +10,13 @@ using namespace std;
 #include "GLUT/glut.h"
 #endif
 //------------------------------------------------------------------------------
+#include "prediction/ExponentialAverage.h"
+#include "prediction/FileWatcher.h"
+#include "prediction/OneEuroFilter.h"
+#include "prediction/PredictorParameters.h"
+#include "prediction/RcuCell.h"
+#include "prediction/WorkspaceBound.h"
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 // GENERAL SETTINGS
@@ -30,6 +37,20 @@ bool fullscreen = false;
 // mirrored display
 bool mirroredDisplay = false;
 
+// predictor parameters, reloaded whenever the file is saved
+const char* PARAMETER_FILE = "predictor.cfg";
+
+// haptic rate [Hz] assumed by the smoothing filters until the rate has been measured
+constexpr double NOMINAL_HAPTIC_RATE = 1000.0;
+
+// velocity smoothing, selected with key 3
+const int SMOOTHING_AVERAGE     = 0;    // running average over the averaging cycle
+const int SMOOTHING_EXPONENTIAL = 1;    // exponential average with a fixed time constant
+const int SMOOTHING_ONE_EURO    = 2;    // One Euro filter, cutoff following the rate of change
+
+// smoothing factor of the exponential average until the parameters and rate are known
+constexpr double NOMINAL_EMA_ALPHA = emaAlpha(DEFAULT_EMA_TIME_CONSTANT, 1.0 / NOMINAL_HAPTIC_RATE);
+
 
 //------------------------------------------------------------------------------
 // DECLARED VARIABLES
@@ -80,6 +101,24 @@ bool useDamping = false;
 // flag for using force field (ON/OFF)
 bool useForceField = true;
 
+// velocity smoothing (SMOOTHING_AVERAGE, SMOOTHING_EXPONENTIAL or SMOOTHING_ONE_EURO),
+// set by key 3 and taken up by the haptic thread
+atomic<int> smoothingMode(SMOOTHING_AVERAGE);
+
+// velocity filters replacing the running average (x/y/z lanes, haptic thread only)
+ExponentialAverage<double, LANES_PER_DEVICE> exponentialAverage(NOMINAL_EMA_ALPHA);
+OneEuroFilter<double, LANES_PER_DEVICE> oneEuroFilter;
+
+// filter properties at the current parameters and rate, published by the haptic thread
+// for the message of key 3
+atomic<double> publishedOneEuroLag(0.0);
+atomic<double> publishedEmaAlpha(NOMINAL_EMA_ALPHA);
+atomic<double> publishedEmaLag(0.0);
+atomic<double> publishedEmaNoise(0.0);
+
+// predictions kept inside the device workspace (radius taken from the specifications)
+WorkspaceBound workspaceBound;
+
 // flag to indicate if the haptic simulation currently running
 bool simulationRunning = false;
 
@@ -97,6 +136,10 @@ int windowH;
 int windowPosX;
 int windowPosY;
 
+// predictor parameters read by the haptic thread, replaced by the parameter watcher
+RcuCell<PredictorParameters> predictorParameters(new PredictorParameters());
+FileWatcher parameterWatcher;
+
 
 //------------------------------------------------------------------------------
 // DECLARED FUNCTIONS
@@ -120,6 +163,9 @@ void close(void);
 // main haptics simulation loop
 void updateHaptics(void);
 
+// load the parameter file and hand it to the haptic thread
+void reloadParameters(void);
+
 
 //==============================================================================
 /*
@@ -145,6 +191,7 @@ int main(int argc, char* argv[])
     cout << "Keyboard Options:" << endl << endl;
     cout << "[1] - Enable/Disable potential field" << endl;
     cout << "[2] - Enable/Disable damping" << endl;
+    cout << "[3] - Cycle velocity smoothing (running average / exponential average / One Euro)" << endl;
     cout << "[f] - Enable/Disable full screen mode" << endl;
     cout << "[m] - Enable/Disable vertical mirroring" << endl;
     cout << "[x] - Exit application" << endl;
@@ -283,6 +330,7 @@ int main(int argc, char* argv[])
 
     // retrieve information about the current haptic device
     cHapticDeviceInfo info = hapticDevice->getSpecifications();
+    workspaceBound.setRadius(info.m_workspaceRadius);
 
     // display a reference frame if haptic device supports orientations
     if (info.m_sensedRotation == true)
@@ -319,6 +367,20 @@ int main(int argc, char* argv[])
     camera->m_frontLayer->addChild(labelHapticRate);
 
 
+    //--------------------------------------------------------------------------
+    // PARAMETERS
+    //--------------------------------------------------------------------------
+
+    // parameters from the parameter file if there is one, then follow its changes
+    FILE* parameterFile = fopen(PARAMETER_FILE, "r");
+    if (parameterFile != NULL)
+    {
+        fclose(parameterFile);
+        reloadParameters();
+    }
+    parameterWatcher.start(PARAMETER_FILE, reloadParameters);
+
+
     //--------------------------------------------------------------------------
     // START SIMULATION
     //--------------------------------------------------------------------------
@@ -376,6 +438,21 @@ void keySelect(unsigned char key, int x, int y)
             cout << "> Disable damping        \r";
     }
 
+    // option 3: cycle velocity smoothing
+    if (key == '3')
+    {
+        int mode = (smoothingMode.load() + 1) % 3;
+        smoothingMode.store(mode);
+        if (mode == SMOOTHING_EXPONENTIAL)
+            cout << "> Exponential average velocity filter (alpha " << cStr(publishedEmaAlpha.load(), 4)
+                 << ", lag " << cStr(publishedEmaLag.load(), 1) << " samples, noise x"
+                 << cStr(publishedEmaNoise.load(), 2) << ")   \r";
+        else if (mode == SMOOTHING_ONE_EURO)
+            cout << "> One Euro velocity filter (lag at rest " << cStr(1000.0 * publishedOneEuroLag.load(), 1) << " ms)   \r";
+        else
+            cout << "> Running average velocity filter                          \r";
+    }
+
     // option f: toggle fullscreen
     if (key == 'f')
     {
@@ -414,6 +491,9 @@ void close(void)
     // wait for graphics and haptics loops to terminate
     while (!simulationFinished) { cSleepMs(100); }
 
+    // stop following the parameter file
+    parameterWatcher.stop();
+
     // close haptic device
     hapticDevice->close();
 }
@@ -473,7 +553,8 @@ void updateGraphics(void)
     labelHapticDevicePosition->setLocalPos(20, windowH - 60, 0);
 
     // display haptic rate data
-    labelHapticRate->setText(cStr(frequencyCounter.getFrequency(), 0) + " Hz");
+    labelHapticRate->setText(cStr(frequencyCounter.getFrequency(), 0) + " Hz  (" +
+                             cStr((double)workspaceBound.getViolations(), 0) + " predictions outside the workspace)");
 
     // update position of label
     labelHapticRate->setLocalPos((int)(0.5 * (windowW - labelHapticRate->getWidth())), 15);
@@ -534,10 +615,13 @@ void updateHaptics(void)
     double avgy;
     double avgz;
 
-    //limit values for x, y, z
-    double limx = .05;
-    double limy = .05;
-    double limz = .05;
+    //last operand of the running average cycle
+    int lastOperand = RunningAveragePredictor::CYCLE - 1;
+
+    // parameter block the smoothing filters were configured from, and the one in use
+    unsigned long long smoothingVersion = 0;
+    bool smoothingConfigured = false;
+    int smoothingActive = SMOOTHING_AVERAGE;
 
     // main haptic simulation loop
     while(simulationRunning)
@@ -548,9 +632,42 @@ void updateHaptics(void)
         /////////////////////////////////////////////////////////////////////
 
         int cnt;
-        for( cnt = 0; cnt <= 30; cnt++ ){
+        for( cnt = 0; cnt <= lastOperand; cnt++ ){
             double operand = double(cnt);
 
+            // current parameter block (replaced as a whole by the parameter watcher)
+            unsigned long long version = predictorParameters.getVersion();
+            const PredictorParameters* parameters = predictorParameters.read();
+            double limx = parameters->m_velocityLimit[0];
+            double limy = parameters->m_velocityLimit[1];
+            double limz = parameters->m_velocityLimit[2];
+            double jitterThreshold = parameters->m_jitterThreshold;
+            double stopThreshold = parameters->m_stopThreshold;
+            lastOperand = parameters->m_averageCycle - 1;
+
+            // recompute the smoothing coefficients for new parameters or a changed haptic rate
+            double rate = frequencyCounter.getFrequency();
+            if (rate <= 0.0) { rate = NOMINAL_HAPTIC_RATE; }
+            if (!smoothingConfigured || version != smoothingVersion || abs(rate - oneEuroFilter.getRate()) > 0.05 * oneEuroFilter.getRate())
+            {
+                exponentialAverage.setTimeConstant(parameters->m_emaTimeConstant, rate);
+                oneEuroFilter.configure(parameters->m_oneEuroMinCutoff, parameters->m_oneEuroBeta,
+                                        parameters->m_oneEuroDerivativeCutoff, rate);
+                publishedOneEuroLag.store(oneEuroFilter.getRestLag());
+                publishedEmaAlpha.store(exponentialAverage.getAlpha());
+                publishedEmaLag.store(exponentialAverage.getLagSamples());
+                publishedEmaNoise.store(exponentialAverage.getNoiseRatio());
+                smoothingVersion = version;
+                smoothingConfigured = true;
+            }
+            int mode = smoothingMode.load();
+            if (mode != smoothingActive)
+            {
+                exponentialAverage.reset();
+                oneEuroFilter.reset();
+                smoothingActive = mode;
+            }
+
             /////////////////////////////////////////////////////////////////////
             // READ HAPTIC DEVICE
             /////////////////////////////////////////////////////////////////////
@@ -581,14 +698,32 @@ void updateHaptics(void)
             pz = prevLinearVelocity.get(2);
 
             prevLinearVelocity.set(px, py, pz);
-            avgx = runningAverage(avgx, cx, operand);
-            avgy = runningAverage(avgy, cy, operand);
-            avgz = runningAverage(avgz, cz, operand);
+            if (smoothingActive != SMOOTHING_AVERAGE)
+            {
+                // one multiply-add per axis, or a cutoff following the rate of change of each axis
+                double smoothed[3] = { cx, cy, cz };
+                LaneVector<double, LANES_PER_DEVICE> lanes;
+                lanes.load(smoothed);
+                if (smoothingActive == SMOOTHING_EXPONENTIAL)
+                    exponentialAverage.filter(lanes);
+                else
+                    oneEuroFilter.filter(lanes);
+                lanes.store(smoothed);
+                avgx = smoothed[0];
+                avgy = smoothed[1];
+                avgz = smoothed[2];
+            }
+            else
+            {
+                avgx = runningAverage(avgx, cx, operand);
+                avgy = runningAverage(avgy, cy, operand);
+                avgz = runningAverage(avgz, cz, operand);
+            }
 
             avgLinearVelocity.set(avgx, avgy, avgz);
 
             //discard linear velocity as jitter based on threshold value
-            if ( abs(px-cx) >= .009 )
+            if ( abs(px-cx) >= jitterThreshold )
             {
                 linearVelocity = prevLinearVelocity;
             }
@@ -596,7 +731,7 @@ void updateHaptics(void)
             {
                 prevLinearVelocity = linearVelocity;
             }
-            if ( abs(py-cy) >= .009 )
+            if ( abs(py-cy) >= jitterThreshold )
             {
                 linearVelocity = prevLinearVelocity;
             }
@@ -604,7 +739,7 @@ void updateHaptics(void)
             {
                 prevLinearVelocity = linearVelocity;
             }
-            if ( abs(pz-cz) >= .009 )
+            if ( abs(pz-cz) >= jitterThreshold )
             {
                 linearVelocity = prevLinearVelocity;
             }
@@ -649,14 +784,21 @@ void updateHaptics(void)
             cursor->setLocalPos(position);
             cursor->setLocalRot(rotation);
 
-            // update predicted position indicator
-            predictIndicator->setLocalPos(cAdd(position, linearVelocity));
+            // update predicted position indicator (within reach of the device)
+            MotionPrediction prediction;
+            for (int i = 0; i < 3; i++)
+            {
+                prediction.m_position[i] = position.get(i) + linearVelocity.get(i);
+                prediction.m_velocity[i] = linearVelocity.get(i);
+            }
+            workspaceBound.constrain(prediction);
+            predictIndicator->setLocalPos(prediction.m_position[0], prediction.m_position[1], prediction.m_position[2]);
 
             // update global variable for graphic display update
             hapticDevicePosition = position;
 
             // reset predict location if velocity low
-            if ( abs(cx) + abs(cy) +abs(cz) < .001){
+            if ( abs(cx) + abs(cy) +abs(cz) < stopThreshold){
                 predictIndicator->setLocalPos(position);
                 cx = 0.0;
                 cy = 0.0;
@@ -666,7 +808,10 @@ void updateHaptics(void)
             // update frequency counter
             frequencyCounter.signal(1);
 
-            if(cnt == 30){
+            // no parameter block is held past this point
+            predictorParameters.quiescent();
+
+            if(cnt >= lastOperand){
                 cnt = 0;
             }
 
@@ -676,4 +821,23 @@ void updateHaptics(void)
     
     // exit haptics thread
     simulationFinished = true;
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+
+void reloadParameters(void)
+{
+    PredictorParameters parameters;
+    string error;
+    if (loadPredictorParameters(PARAMETER_FILE, parameters, error))
+    {
+        predictorParameters.publish(new PredictorParameters(parameters));
+        cout << "> Loaded " << PARAMETER_FILE << "                            \r";
+    }
+    else
+    {
+        cout << "> " << PARAMETER_FILE << ": " << error << " (parameters unchanged)" << endl;
+    }
+}
+
+//------------------------------------------------------------------------------
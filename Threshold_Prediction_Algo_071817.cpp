@@ -53,6 +53,28 @@ using namespace std;
 #include "GLUT/glut.h"
 #endif
 //------------------------------------------------------------------------------
+#include "graphics/SceneSettings.h"
+#include "graphics/ScopePlot.h"
+#include "graphics/TrailMesh.h"
+#include "prediction/AlphaBetaGammaPredictor.h"
+#include "prediction/CostMeter.h"
+#include "prediction/DeadlineWatchdog.h"
+#include "prediction/EnsemblePredictor.h"
+#include "prediction/FileWatcher.h"
+#include "prediction/KernelAccuracy.h"
+#include "prediction/LaneKernels.h"
+#include "prediction/LearnedPredictor.h"
+#include "prediction/MetricsExporter.h"
+#include "prediction/MultiRateScheduler.h"
+#include "prediction/PredictionErrorTracker.h"
+#include "prediction/PredictorParameters.h"
+#include "prediction/PredictorSwitcher.h"
+#include "prediction/Predictors.h"
+#include "prediction/RcuCell.h"
+#include "prediction/RlsArPredictor.h"
+#include "prediction/TraceWriter.h"
+#include "prediction/WorkspaceBound.h"
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 // GENERAL SETTINGS
@@ -73,6 +95,72 @@ bool fullscreen = false;
 // mirrored display
 bool mirroredDisplay = false;
 
+// the prediction horizon, the scene rate and the sizes of the trails and the scope
+// are in graphics/SceneSettings.h, shared with RenderBenchmark
+
+// rates [Hz] of the other haptic loop stages
+const double READ_RATE    = 4000.0;     // device read and anti-aliasing filter
+const double PREDICT_RATE = 1000.0;     // velocity estimation, prediction and error tracking
+const double PUBLISH_RATE = 10.0;       // statistics handed to the graphics thread
+const double RECORD_RATE  = 1000.0;     // trace recording
+const double FORCE_RATE   = 1000.0;     // force computation (servo rate of the Touch)
+
+// latency [s] between reading the device and the force taking effect, compensated
+// by the predictive force mode (one servo period)
+const double FORCE_LATENCY = 1.0 / FORCE_RATE;
+
+// degradation levels at which optional work is shed when ticks overrun their budget
+const int SHED_VISUAL    = 1;           // scene updates, button polling and statistics publishing
+const int SHED_SECONDARY = 2;           // ensemble members other than the threshold predictor
+
+// force modes (selected with key 6)
+const int FORCE_OFF        = 0;         // no force sent
+const int FORCE_MEASURED   = 1;         // forces from the measured position and velocity
+const int FORCE_PREDICTIVE = 2;         // forces from the position extrapolated over FORCE_LATENCY
+
+// stiffness [N/m] of the force field at startup and its step (keys + and -)
+const double FORCE_STIFFNESS      = 25.0;
+const double FORCE_STIFFNESS_STEP = 5.0;
+
+// an axis force that reverses between two force ticks while above this fraction of the
+// device's maximum force on both ticks is chatter, the sign of an unstable field
+const double CHATTER_FORCE = 0.1;
+
+// time [s] a stiffness must render without chatter to count as stable in a force mode
+const double STABLE_TIME = 2.0;
+
+// range of the velocity scope [m/s]
+const double SCOPE_RANGE = 2.0 * DEFAULT_VELOCITY_LIMIT;
+
+// predictor parameters, reloaded whenever the file is saved
+const char* PARAMETER_FILE = "predictor.cfg";
+
+// model of the learned predictor (tools/ModelTrainer.cpp), read at start
+const char* MODEL_FILE = "predictor.model";
+
+// predictor variants cycled with key 5 (names accepted by selectPredictor; "learned"
+// is skipped when no model was loaded)
+const int NUM_PREDICTOR_VARIANTS = 8;
+const char* PREDICTOR_VARIANTS[NUM_PREDICTOR_VARIANTS] =
+    { "threshold", "running average", "savitzky-golay", "alpha-beta-gamma", "rls-ar", "learned", "ensemble-best", "ensemble-blend" };
+
+// samples fed to a predictor variant in the background before it takes over (0.5 s)
+const int PREDICTOR_WARMUP_SAMPLES = 500;
+
+// file receiving the prediction error statistics
+const char* PREDICTION_ERROR_FILE = "prediction_error.csv";
+
+// file receiving the recorded trace
+const char* TRACE_FILE = "session.trace";
+
+// metrics in Prometheus text format: file rewritten every second and local HTTP port
+// (http://127.0.0.1:9464/metrics, POSIX only)
+const char* METRICS_FILE = "haptic_metrics.prom";
+const int METRICS_PORT = 9464;
+
+// metrics slot block written by the haptic thread
+const int METRICS_HAPTIC_THREAD = 0;
+
 
 //------------------------------------------------------------------------------
 // DECLARED VARIABLES
@@ -105,6 +193,18 @@ cVector3d hapticDevicePosition;
 // a label to display the rate [Hz] at which the simulation is running
 cLabel* labelHapticRate;
 
+// a label to display the live prediction error statistics
+cLabel* labelPredictionError;
+
+// a label to display the ensemble selection and cost
+cLabel* labelEnsemble;
+
+// a label to display the trace recording state
+cLabel* labelTrace;
+
+// a label to display the force mode and cost
+cLabel* labelForce;
+
 // a small sphere (cursor) representing the haptic device 
 cShapeSphere* cursor;
 
@@ -114,12 +214,122 @@ cShapeSphere* predictIndicator;
 // a line representing the velocity vector of the haptic device
 cShapeLine* velocity;
 
+// recent paths of the measured and predicted positions
+TrailMesh<TRAIL_POINTS>* actualTrail;
+TrailMesh<TRAIL_POINTS>* predictedTrail;
+
+// flag for showing the trails (ON/OFF)
+bool showTrails = true;
+
+// scope of the device (channels 0-2) and predictor (channels 3-5) velocity
+ScopePlot<6, SCOPE_HISTORY>* velocityScope;
+
+// axis shown by the scope (-1: hidden)
+int scopeAxis = -1;
+
 // flag for using damping (ON/OFF)
 bool useDamping = false;
 
 // flag for using force field (ON/OFF)
 bool useForceField = true;
 
+// force rendering mode (FORCE_OFF, FORCE_MEASURED or FORCE_PREDICTIVE)
+atomic<int> forceMode(FORCE_OFF);
+
+// stiffness [N/m] of the force field, set with keys + and -
+atomic<double> forceStiffness(FORCE_STIFFNESS);
+
+// force ticks with chatter, and the highest stiffness each force mode has rendered for
+// STABLE_TIME without chatter (haptic thread)
+atomic<unsigned long long> forceChatter(0);
+atomic<double> stableStiffness[3];
+
+// specifications of the haptic device, read once at startup
+cHapticDeviceInfo hapticDeviceInfo;
+
+// predictions kept inside the device workspace (radius taken from the specifications)
+WorkspaceBound workspaceBound;
+
+// cost of the force stage per tick
+CostMeter forceCost;
+
+// budget monitor of the haptic loop (one read period per tick)
+DeadlineWatchdog watchdog(1.0 / READ_RATE);
+
+// haptic loop telemetry and its exporter
+Metrics metrics;
+MetricsExporter metricsExporter(metrics);
+
+// predictor parameters read by the haptic thread, replaced by the parameter watcher
+RcuCell<PredictorParameters> predictorParameters(new PredictorParameters());
+FileWatcher parameterWatcher;
+
+// metric handles
+int metricTicks;
+int metricTickSeconds;
+int metricRate[2];
+int metricMissed[2];
+int metricOverruns;
+int metricDegradations[2];
+int metricJitterRejections[3];
+int metricClampHits[3];
+int metricErrorRmse[3];
+int metricErrorP95[3];
+int metricErrorsDropped;
+int metricWorkspaceViolations;
+int metricTraceSamples;
+int metricTraceDropped;
+int metricForceCost;
+int metricForceChatter;
+
+// threshold predictor (velocity source and thresholds selected with keys 3 and 4)
+ThresholdPredictor thresholdPredictor;
+
+// options of keys 3, 4 and 7, set by the GUI thread (the median window also by the
+// parameter file); the haptic thread applies them to the threshold predictors when the
+// version changes (see configurePredictor)
+atomic<bool> optionSavitzkyGolay(false);
+atomic<bool> optionAdaptiveThreshold(false);
+atomic<int> optionMedianWindow(1);
+atomic<unsigned long long> optionVersion(0);
+
+// lag [s] and adaptive thresholds of the running threshold predictor, published by the
+// haptic thread for the messages of keys 3 and 4
+atomic<double> publishedSgLag(0.0);
+atomic<double> publishedJitterThreshold(0.0);
+atomic<double> publishedStopThreshold(0.0);
+
+// alternative predictors
+RunningAveragePredictor runningAveragePredictor;
+SavitzkyGolayPredictor sgPredictor;
+AlphaBetaGammaPredictor abgPredictor;
+RlsArPredictor rlsPredictor;
+LearnedPredictor learnedPredictor;
+
+// ensemble of the threshold, running average and Savitzky-Golay predictors (the others
+// are variants only), scored at the prediction horizon; it has instances of
+// its own so that every variant can be warmed up while another one is active
+ThresholdPredictor ensembleThreshold;
+RunningAveragePredictor ensembleRunningAverage;
+SavitzkyGolayPredictor ensembleSg;
+EnsemblePredictor ensemblePredictor(PREDICTION_HORIZON);
+
+// predictor variant in use, switched after a warm-up in the background
+PredictorSwitcher predictorSwitcher(PREDICTOR_WARMUP_SAMPLES);
+int ensembleVariant;
+
+// entry of PREDICTOR_VARIANTS selected last
+int predictorVariant = 0;
+
+// compressed recording of the device samples
+TraceWriter traceWriter;
+
+// predictions waiting for their target time and the resulting error statistics
+PredictionErrorTracker<16384> predictionError;
+
+// flag requesting the haptic thread to clear the prediction error statistics
+bool resetPredictionError = false;
+
 // flag to indicate if the haptic simulation currently running
 bool simulationRunning = false;
 
@@ -129,6 +339,9 @@ bool simulationFinished = true;
 // frequency counter to measure the simulation haptic rate
 cFrequencyCounter frequencyCounter;
 
+// frequency counter to measure the prediction rate
+cFrequencyCounter predictFrequencyCounter;
+
 // information about computer screen and GLUT display window
 int screenW;
 int screenH;
@@ -160,6 +373,21 @@ void close(void);
 // main haptics simulation loop
 void updateHaptics(void);
 
+// register the haptic loop metrics
+void registerMetrics(void);
+
+// load the parameter file and hand it to the haptic thread
+void reloadParameters(void);
+
+// switch to the predictor variant called a_name (see PREDICTOR_VARIANTS), false if unknown
+bool selectPredictor(const char* a_name);
+
+// apply the current parameter block to a predictor variant (haptic thread)
+void configurePredictor(MotionPredictor* a_variant);
+
+// apply the parameter block and the options of keys 3, 4 and 7 to a threshold predictor
+void configureThreshold(const PredictorParameters& a_parameters, ThresholdPredictor& a_predictor);
+
 
 //==============================================================================
 /*
@@ -194,11 +422,30 @@ int main(int argc, char* argv[])
     cout << "Keyboard Options:" << endl << endl;
     cout << "[1] - Enable/Disable potential field" << endl;
     cout << "[2] - Enable/Disable damping" << endl;
+    cout << "[3] - Enable/Disable Savitzky-Golay velocity" << endl;
+    cout << "[4] - Enable/Disable adaptive jitter thresholds" << endl;
+    cout << "[5] - Cycle predictor (threshold / running average / Savitzky-Golay / alpha-beta-gamma / RLS AR / learned / ensemble best / blend)" << endl;
+    cout << "[6] - Cycle force mode (off / measured / predictive)" << endl;
+    cout << "[7] - Cycle median velocity prefilter (off / 3 / 5 / 7 samples)" << endl;
+    cout << "[+] - Increase force field stiffness" << endl;
+    cout << "[-] - Decrease force field stiffness" << endl;
+    cout << "[e] - Export prediction error statistics" << endl;
+    cout << "[c] - Clear prediction error statistics" << endl;
+    cout << "[r] - Start/Stop trace recording" << endl;
+    cout << "[t] - Show/Hide position trails" << endl;
+    cout << "[p] - Cycle velocity scope axis (off / x / y / z)" << endl;
     cout << "[f] - Enable/Disable full screen mode" << endl;
     cout << "[m] - Enable/Disable vertical mirroring" << endl;
     cout << "[x] - Exit application" << endl;
     cout << endl << endl;
 
+#ifdef PREDICTION_FLOAT32
+    // confirm that single precision kernels stay well below the device resolution
+    KernelAccuracy accuracy = checkKernelAccuracy<PredictionScalar, SG_HALF_WINDOW>(PREDICT_RATE, 0.2 * PREDICT_RATE, PREDICTION_HORIZON);
+    cout << "float32 kernels: max prediction deviation from double " << cStr(1000.0 * accuracy.m_maxPredictionError, 4)
+         << " mm (device resolution " << cStr(1000.0 * TOUCH_POSITION_RESOLUTION, 3) << " mm)" << endl << endl;
+#endif
+
 
     //--------------------------------------------------------------------------
     // OPENGL - WINDOW DISPLAY
@@ -308,6 +555,12 @@ int main(int argc, char* argv[])
     // insert line inside world
     world->addChild(velocity);
 
+    // create the trails of the measured and predicted positions
+    actualTrail = new TrailMesh<TRAIL_POINTS>(cColorf(0.25f, 0.41f, 0.88f));
+    predictedTrail = new TrailMesh<TRAIL_POINTS>(cColorf(1.0f, 0.84f, 0.0f));
+    world->addChild(actualTrail);
+    world->addChild(predictedTrail);
+
 
     //--------------------------------------------------------------------------
     // HAPTIC DEVICE
@@ -325,11 +578,12 @@ int main(int argc, char* argv[])
     // calibrate device (if necessary)
     hapticDevice->calibrate();
 
-    // retrieve information about the current haptic device
-    cHapticDeviceInfo info = hapticDevice->getSpecifications();
+    // retrieve information about the current haptic device (cached for the haptic loop)
+    hapticDeviceInfo = hapticDevice->getSpecifications();
+    workspaceBound.setRadius(hapticDeviceInfo.m_workspaceRadius);
 
     // display a reference frame if haptic device supports orientations
-    if (info.m_sensedRotation == true)
+    if (hapticDeviceInfo.m_sensedRotation == true)
     {
         // display reference frame
         cursor->setShowFrame(true);
@@ -352,7 +606,7 @@ int main(int argc, char* argv[])
     // create a label to display the haptic device model
     labelHapticDeviceModel = new cLabel(font);
     camera->m_frontLayer->addChild(labelHapticDeviceModel);
-    labelHapticDeviceModel->setText(info.m_modelName);
+    labelHapticDeviceModel->setText(hapticDeviceInfo.m_modelName);
 
     // create a label to display the position of haptic device
     labelHapticDevicePosition = new cLabel(font);
@@ -362,6 +616,90 @@ int main(int argc, char* argv[])
     labelHapticRate = new cLabel(font);
     camera->m_frontLayer->addChild(labelHapticRate);
 
+    // create a label to display the prediction error
+    labelPredictionError = new cLabel(font);
+    camera->m_frontLayer->addChild(labelPredictionError);
+
+    // create a label to display the ensemble state
+    labelEnsemble = new cLabel(font);
+    camera->m_frontLayer->addChild(labelEnsemble);
+
+    // create a label to display the trace recording state
+    labelTrace = new cLabel(font);
+    camera->m_frontLayer->addChild(labelTrace);
+
+    // create a scope comparing device and predictor velocity, with the velocity limits marked
+    velocityScope = new ScopePlot<6, SCOPE_HISTORY>(SCOPE_RANGE);
+    for (int i = 0; i < 3; i++)
+    {
+        velocityScope->setChannelColor(i, cColorf(0.6f, 0.6f, 0.6f));
+        velocityScope->setChannelColor(3 + i, cColorf(1.0f, 0.84f, 0.0f));
+    }
+    velocityScope->addMarker(DEFAULT_VELOCITY_LIMIT);
+    velocityScope->addMarker(-DEFAULT_VELOCITY_LIMIT);
+    velocityScope->setShowEnabled(false);
+    camera->m_frontLayer->addChild(velocityScope);
+
+    // create a label to display the force mode
+    labelForce = new cLabel(font);
+    camera->m_frontLayer->addChild(labelForce);
+
+
+    //--------------------------------------------------------------------------
+    // PREDICTORS
+    //--------------------------------------------------------------------------
+
+    // run the threshold, running average and Savitzky-Golay predictors inside the ensemble
+    ensemblePredictor.addMember(&ensembleThreshold);
+    ensemblePredictor.addMember(&ensembleRunningAverage);
+    ensemblePredictor.addMember(&ensembleSg);
+
+    // variants selectable at run time, the threshold predictor first (active at start)
+    predictorSwitcher.addVariant(&thresholdPredictor);
+    predictorSwitcher.addVariant(&runningAveragePredictor);
+    predictorSwitcher.addVariant(&sgPredictor);
+    predictorSwitcher.addVariant(&abgPredictor);
+    predictorSwitcher.addVariant(&rlsPredictor);
+
+    // the learned predictor only with a model trained at the prediction rate and horizon
+    LearnedModel model;
+    string modelError;
+    if (loadLearnedModel(MODEL_FILE, model, modelError))
+    {
+        learnedPredictor.setModel(model);
+        predictorSwitcher.addVariant(&learnedPredictor);
+        if (cAbs(model.m_period * PREDICT_RATE - 1.0) > 0.05)
+            cout << "warning: " << MODEL_FILE << " was trained at " << cStr(1.0 / model.m_period, 0)
+                 << " Hz, predictions run at " << PREDICT_RATE << " Hz" << endl;
+        if (cAbs(model.m_horizon / PREDICTION_HORIZON - 1.0) > 0.05)
+            cout << "warning: " << MODEL_FILE << " was trained for a " << cStr(model.m_horizon, 3)
+                 << " s horizon, predictions are made " << PREDICTION_HORIZON << " s ahead" << endl;
+    }
+    ensembleVariant = predictorSwitcher.addVariant(&ensemblePredictor);
+    predictorSwitcher.setConfigure(configurePredictor);
+    predictorSwitcher.start();
+
+    // parameters from the parameter file if there is one, then follow its changes
+    FILE* parameterFile = fopen(PARAMETER_FILE, "r");
+    if (parameterFile != NULL)
+    {
+        fclose(parameterFile);
+        reloadParameters();
+    }
+    parameterWatcher.start(PARAMETER_FILE, reloadParameters);
+
+
+    //--------------------------------------------------------------------------
+    // METRICS
+    //--------------------------------------------------------------------------
+
+    registerMetrics();
+    if (!metricsExporter.start(METRICS_FILE, METRICS_PORT))
+    {
+        cout << "metrics: port " << METRICS_PORT << " unavailable, writing " << METRICS_FILE << " only" << endl;
+        metricsExporter.start(METRICS_FILE, 0);
+    }
+
 
     //--------------------------------------------------------------------------
     // START SIMULATION
@@ -420,6 +758,137 @@ void keySelect(unsigned char key, int x, int y)
             cout << "> Disable damping        \r";
     }
 
+    // option 3: select velocity source
+    if (key == '3')
+    {
+        bool enabled = !optionSavitzkyGolay.load();
+        optionSavitzkyGolay.store(enabled);
+        optionVersion++;
+        if (enabled)
+            cout << "> Enable Savitzky-Golay velocity (window " << 2 * SG_HALF_WINDOW + 1 << ", lag "
+                 << cStr(1000.0 * publishedSgLag.load(), 2) << " ms)   \r";
+        else
+            cout << "> Disable Savitzky-Golay velocity          \r";
+    }
+
+    // option 4: select fixed or adaptive thresholds
+    if (key == '4')
+    {
+        bool enabled = !optionAdaptiveThreshold.load();
+        optionAdaptiveThreshold.store(enabled);
+        optionVersion++;
+        if (enabled)
+            cout << "> Enable adaptive thresholds (jitter " << cStr(publishedJitterThreshold.load(), 4)
+                 << " / stop " << cStr(publishedStopThreshold.load(), 4) << ")   \r";
+        else
+            cout << "> Disable adaptive thresholds                      \r";
+    }
+
+    // option 5: cycle predictor variant
+    if (key == '5')
+    {
+        do
+        {
+            predictorVariant = (predictorVariant + 1) % NUM_PREDICTOR_VARIANTS;
+        }
+        while (!selectPredictor(PREDICTOR_VARIANTS[predictorVariant]));
+        cout << "> Predictor: " << PREDICTOR_VARIANTS[predictorVariant] << "                        \r";
+    }
+
+    // option 6: cycle force mode
+    if (key == '6')
+    {
+        forceMode = (forceMode + 1) % 3;
+        forceCost.reset();
+        if (forceMode == FORCE_MEASURED)
+            cout << "> Forces from measured state               \r";
+        else if (forceMode == FORCE_PREDICTIVE)
+            cout << "> Forces from predicted state (" << cStr(1000.0 * FORCE_LATENCY, 1) << " ms ahead)   \r";
+        else
+            cout << "> Forces off                               \r";
+    }
+
+    // option +/-: force field stiffness
+    if ((key == '+') || (key == '=') || (key == '-'))
+    {
+        double stiffness = forceStiffness.load() + ((key == '-') ? -FORCE_STIFFNESS_STEP : FORCE_STIFFNESS_STEP);
+        forceStiffness.store(cMax(stiffness, FORCE_STIFFNESS_STEP));
+        cout << "> Force field stiffness " << cStr(forceStiffness.load(), 0) << " N/m          \r";
+    }
+
+    // option 7: cycle median prefilter window
+    if (key == '7')
+    {
+        int window = (optionMedianWindow.load() == 7) ? 1 : optionMedianWindow.load() + 2;
+        optionMedianWindow.store(window);
+        optionVersion++;
+        if (window > 1)
+            cout << "> Median velocity prefilter over " << window << " samples (lag " << window / 2 << " samples)   \r";
+        else
+            cout << "> Disable median velocity prefilter        \r";
+    }
+
+    // option e: export prediction error statistics
+    if (key == 'e')
+    {
+        if (predictionError.exportCsv(PREDICTION_ERROR_FILE))
+            cout << "> Exported prediction error to " << PREDICTION_ERROR_FILE << "   \r";
+        else
+            cout << "> Cannot write " << PREDICTION_ERROR_FILE << "                   \r";
+    }
+
+    // option c: clear prediction error statistics
+    if (key == 'c')
+    {
+        resetPredictionError = true;
+        cout << "> Cleared prediction error statistics      \r";
+    }
+
+    // option r: start/stop trace recording
+    if (key == 'r')
+    {
+        if (traceWriter.isRecording())
+        {
+            traceWriter.close();
+            cout << "> Stopped recording (" << traceWriter.getSamples() << " samples, "
+                 << cStr(traceWriter.getBytes() / 1048576.0, 1) << " MB)   \r";
+        }
+        else if (traceWriter.open(TRACE_FILE))
+            cout << "> Recording to " << TRACE_FILE << "                   \r";
+        else
+            cout << "> Cannot write " << TRACE_FILE << "                   \r";
+    }
+
+    // option t: show/hide trails
+    if (key == 't')
+    {
+        showTrails = !showTrails;
+        actualTrail->clear();
+        predictedTrail->clear();
+        actualTrail->setShowEnabled(showTrails);
+        predictedTrail->setShowEnabled(showTrails);
+        if (showTrails)
+            cout << "> Show position trails                     \r";
+        else
+            cout << "> Hide position trails                     \r";
+    }
+
+    // option p: cycle velocity scope axis
+    if (key == 'p')
+    {
+        scopeAxis = (scopeAxis == 2) ? -1 : scopeAxis + 1;
+        for (int i = 0; i < 3; i++)
+        {
+            velocityScope->setChannelShown(i, i == scopeAxis);
+            velocityScope->setChannelShown(3 + i, i == scopeAxis);
+        }
+        velocityScope->setShowEnabled(scopeAxis >= 0);
+        if (scopeAxis >= 0)
+            cout << "> Scope: device (gray) vs predicted (gold) velocity, axis " << "xyz"[scopeAxis] << "   \r";
+        else
+            cout << "> Scope: off                                          \r";
+    }
+
     // option f: toggle fullscreen
     if (key == 'f')
     {
@@ -458,6 +927,21 @@ void close(void)
     // wait for graphics and haptics loops to terminate
     while (!simulationFinished) { cSleepMs(100); }
 
+    // keep the prediction error statistics of the session
+    predictionError.exportCsv(PREDICTION_ERROR_FILE);
+
+    // write the rest of the trace
+    traceWriter.close();
+
+    // stop serving metrics
+    metricsExporter.stop();
+
+    // stop following the parameter file
+    parameterWatcher.stop();
+
+    // stop warming up predictors
+    predictorSwitcher.stop();
+
     // close haptic device
     hapticDevice->close();
 }
@@ -474,20 +958,6 @@ void graphicsTimer(int data)
     glutTimerFunc(50, graphicsTimer, 0);
 }
 
-//------------------------------------------------------------------------------
-//function for velocity upper limit
-double axisUpperLim (double a, double limit)
-{
-
-    if( a > limit){
-        a = limit;
-    }
-    if( a < -limit){
-        a = -limit;
-    }
-    return a;
-
-}
 //------------------------------------------------------------------------------
 
 void updateGraphics(void)
@@ -506,11 +976,92 @@ void updateGraphics(void)
     labelHapticDevicePosition->setLocalPos(20, windowH - 60, 0);
 
     // display haptic rate data
-    labelHapticRate->setText(cStr(frequencyCounter.getFrequency(), 0) + " Hz");
+    labelHapticRate->setText(cStr(frequencyCounter.getFrequency(), 0) + " Hz read / " +
+                             cStr(predictFrequencyCounter.getFrequency(), 0) + " Hz predict  overruns " +
+                             cStr((int)watchdog.getOverruns()) + "  shed " +
+                             cStr((int)watchdog.getEvents(SHED_VISUAL)) + " / " +
+                             cStr((int)watchdog.getEvents(SHED_SECONDARY)) +
+                             ((watchdog.getLevel() > 0) ? "  (degraded " + cStr(watchdog.getLevel()) + ")" : string("")));
 
     // update position of label
     labelHapticRate->setLocalPos((int)(0.5 * (windowW - labelHapticRate->getWidth())), 15);
 
+    // display prediction error [mm] per axis
+    PredictionErrorSummary error = predictionError.getSummary();
+    labelPredictionError->setText("error [mm]  rms " +
+        cStr(1000.0 * error.m_rmse[0], 2) + " / " + cStr(1000.0 * error.m_rmse[1], 2) + " / " + cStr(1000.0 * error.m_rmse[2], 2) + "  p95 " +
+        cStr(1000.0 * error.m_p95[0], 2) + " / " + cStr(1000.0 * error.m_p95[1], 2) + " / " + cStr(1000.0 * error.m_p95[2], 2) + "  max " +
+        cStr(1000.0 * error.m_max[0], 2) + " / " + cStr(1000.0 * error.m_max[1], 2) + " / " + cStr(1000.0 * error.m_max[2], 2) +
+        "  outside workspace " + cStr((double)workspaceBound.getViolations(), 0));
+
+    // update position of label
+    labelPredictionError->setLocalPos(20, windowH - 80, 0);
+
+    // display the predictor in use, the cost of the last switch and, for the ensemble,
+    // its selection and per-tick cost against the prediction budget
+    string predictorText = string("predictor ") + predictorSwitcher.getName();
+    if (predictorSwitcher.getActive() == ensembleVariant)
+    {
+        int best = ensemblePredictor.getBest();
+        predictorText += string(" ") +
+            ((ensemblePredictor.getMode() == EnsemblePredictor::ENSEMBLE_BLEND) ? "blend" : "best") +
+            " [" + ensemblePredictor.getMember(best)->getName() + "]  cost " +
+            cStr(1e6 * ensemblePredictor.getCostAverage(), 1) + " us avg / " +
+            cStr(1e6 * ensemblePredictor.getCostMax(), 1) + " us max of " +
+            cStr(1e6 / PREDICT_RATE, 0) + " us";
+    }
+    if (predictorSwitcher.isSwitching())
+    {
+        predictorText += string("  warming up ") + predictorSwitcher.getVariant(predictorSwitcher.getRequested())->getName();
+    }
+    else if (predictorSwitcher.getSwitches() > 0)
+    {
+        predictorText += "  last switch " + cStr(1e6 * predictorSwitcher.getSwitchCost().getMax(), 1) + " us max in loop, warm-up " +
+                         cStr(1000.0 * predictorSwitcher.getWarmupTime(), 0) + " ms";
+    }
+    labelEnsemble->setText(predictorText);
+
+    // update position of label
+    labelEnsemble->setLocalPos(20, windowH - 100, 0);
+
+    // display trace recording progress
+    if (traceWriter.isRecording())
+    {
+        labelTrace->setText("REC " + cStr(traceWriter.getSamples() / RECORD_RATE, 0) + " s  " +
+                            cStr(traceWriter.getBytes() / 1048576.0, 1) + " MB  dropped " +
+                            cStr((int)traceWriter.getDropped()));
+    }
+    else
+    {
+        labelTrace->setText("");
+    }
+
+    // update position of label
+    labelTrace->setLocalPos(20, windowH - 120, 0);
+
+    // velocity scope along the bottom of the window
+    velocityScope->setLocalPos(20, 20, 0);
+    velocityScope->setSize(windowW - 40, 120);
+
+    // display force mode, stiffness, chatter and the highest stiffness each mode has
+    // rendered stably, and the per-tick cost against the force budget
+    if (forceMode != FORCE_OFF)
+    {
+        labelForce->setText(string((forceMode == FORCE_PREDICTIVE) ? "predictive" : "measured") + " force  Kp " +
+                            cStr(forceStiffness.load(), 0) + " N/m  chatter " + cStr((int)forceChatter.load()) +
+                            "  stable up to " + cStr(stableStiffness[FORCE_MEASURED].load(), 0) + " / " +
+                            cStr(stableStiffness[FORCE_PREDICTIVE].load(), 0) + " N/m (measured / predictive)  cost " +
+                            cStr(1e6 * forceCost.getAverage(), 1) + " us avg / " +
+                            cStr(1e6 * forceCost.getMax(), 1) + " us max of " + cStr(1e6 / FORCE_RATE, 0) + " us");
+    }
+    else
+    {
+        labelForce->setText("");
+    }
+
+    // update position of label
+    labelForce->setLocalPos(20, windowH - 140, 0);
+
 
     /////////////////////////////////////////////////////////////////////
     // RENDER SCENE
@@ -538,207 +1089,593 @@ void updateGraphics(void)
 
 void updateHaptics(void)
 {
-    // initialize frequency counter
+    // initialize frequency counters
     frequencyCounter.reset();
+    predictFrequencyCounter.reset();
 
     // simulation in now running
     simulationRunning  = true;
     simulationFinished = false;
 
-    //declare previous linear velocity
-    cVector3d prevLinearVelocity;
-    prevLinearVelocity.set (0.0,0.0,0.0);
-
-    //caomparative values for previous velocity
-    double px;
-    double py;
-    double pz;
-
-    //comparative values for current velocity
-    double cx;
-    double cy;
-    double cz;
-
-    //limit values for x, y, z
-    double limx = .05;
-    double limy = .05;
-    double limz = .05;
+    // x/y/z of the device packed in lanes of the kernel scalar type
+    typedef LaneVector<PredictionScalar, LANES_PER_DEVICE> Lanes;
+
+    // clock used to timestamp position samples
+    cPrecisionClock clock;
+    clock.start(true);
+
+    // stages of the loop and their rates
+    MultiRateScheduler scheduler;
+    int stageRead    = scheduler.addStage(READ_RATE);
+    int stagePredict = scheduler.addStage(PREDICT_RATE);
+    int stageScene   = scheduler.addStage(SCENE_RATE);
+    int stagePublish = scheduler.addStage(PUBLISH_RATE);
+    int stageRecord  = scheduler.addStage(RECORD_RATE);
+    int stageForce   = scheduler.addStage(FORCE_RATE);
+
+    // anti-aliasing filters applied at read rate before decimation to the prediction rate
+    // (cutoff at 40% of the prediction Nyquist frequency)
+    LowPassBiquad<PredictionScalar> positionFilter;
+    LowPassBiquad<PredictionScalar> velocityFilter;
+    positionFilter.design(READ_RATE, 0.2 * PREDICT_RATE);
+    velocityFilter.design(READ_RATE, 0.2 * PREDICT_RATE);
+
+    // latest raw and filtered device state
+    cVector3d position;
+    Lanes filteredPosition;
+    Lanes filteredVelocity;
+
+    // latest prediction output
+    cVector3d linearVelocity;
+    cVector3d predictedPosition;
+
+    // true while the ensemble is shed and only its threshold member is updated
+    bool ensembleStale = false;
+
+    // version of the parameter block and of the options applied to the active predictor
+    // (0: defaults)
+    unsigned long long parameterVersion = 0;
+    unsigned long long appliedOptions = 0;
+
+    // linear force of the previous force tick, and the mode, stiffness and chatter count
+    // since which the current stiffness has rendered without chatter
+    cVector3d lastForce(0.0, 0.0, 0.0);
+    int heldMode = FORCE_OFF;
+    double heldStiffness = 0.0;
+    unsigned long long heldChatter = 0;
+    double heldSince = 0.0;
 
     // main haptic simulation loop
     while(simulationRunning)
     {
+        // spin until the next read slot
+        double time = clock.getCurrentTimeSeconds();
+        if (!scheduler.isDue(stageRead, time)) { continue; }
+
+
         /////////////////////////////////////////////////////////////////////
         // READ HAPTIC DEVICE
         /////////////////////////////////////////////////////////////////////
 
         // read position 
-        cVector3d position;
         hapticDevice->getPosition(position);
-        
-        // read orientation 
-        cMatrix3d rotation;
-        hapticDevice->getRotation(rotation);
-
-        // read gripper position
-        double gripperAngle;
-        hapticDevice->getGripperAngleRad(gripperAngle);
 
         // read linear velocity 
-        cVector3d linearVelocity;
-        hapticDevice->getLinearVelocity(linearVelocity);
-        cx = axisUpperLim(linearVelocity.get(0), limx);
-        cy = axisUpperLim(linearVelocity.get(1), limy);
-        cz = axisUpperLim(linearVelocity.get(2), limz);
+        cVector3d deviceVelocity;
+        hapticDevice->getLinearVelocity(deviceVelocity);
+
+        // band-limit both signals before they are decimated
+        double rawPosition[3] = { position.get(0), position.get(1), position.get(2) };
+        double rawVelocity[3] = { deviceVelocity.get(0), deviceVelocity.get(1), deviceVelocity.get(2) };
+        Lanes positionLanes, velocityLanes;
+        positionLanes.load(rawPosition);
+        velocityLanes.load(rawVelocity);
+        positionFilter.filter(positionLanes, filteredPosition);
+        velocityFilter.filter(velocityLanes, filteredVelocity);
 
-        linearVelocity.set(cx, cy, cz);
+        // update frequency counter
+        frequencyCounter.signal(1);
 
-        px = prevLinearVelocity.get(0);
-        py = prevLinearVelocity.get(1);
-        pz = prevLinearVelocity.get(2);
 
-        //discard linear velocity as jitter based on threshold value
-        if ( abs(px-cx) >= .009 )
-        {
-            linearVelocity = prevLinearVelocity;
-        }
-        else
+        /////////////////////////////////////////////////////////////////////
+        // PREDICT POSITION
+        /////////////////////////////////////////////////////////////////////
+
+        if (scheduler.isDue(stagePredict, time))
         {
-            prevLinearVelocity = linearVelocity;
+            // take up a new parameter block or new options in the active variant only; a
+            // variant being warmed up belongs to the warm-up thread and is configured by
+            // the switcher
+            unsigned long long version = predictorParameters.getVersion();
+            unsigned long long options = optionVersion.load();
+            if (version != parameterVersion || options != appliedOptions)
+            {
+                configurePredictor(predictorSwitcher.getVariant(predictorSwitcher.getActive()));
+                parameterVersion = version;
+                appliedOptions = options;
+            }
+
+            MotionSample sample;
+            sample.m_time = time;
+            filteredPosition.store(sample.m_position);
+            filteredVelocity.store(sample.m_velocity);
+
+            // run the active predictor variant; under sustained overruns the ensemble falls
+            // back to its threshold member and restarts from scratch once it comes back
+            bool fallback = (predictorSwitcher.getActive() == ensembleVariant) && watchdog.isShed(SHED_SECONDARY);
+            if (!fallback && ensembleStale && predictorSwitcher.getActive() == ensembleVariant) { ensemblePredictor.reset(); }
+            ensembleStale = fallback;
+
+            MotionPrediction prediction;
+            if (fallback)
+            {
+                ensembleThreshold.update(sample);
+                ensembleThreshold.predict(PREDICTION_HORIZON, prediction);
+                predictorSwitcher.track(sample);
+            }
+            else
+            {
+                predictorSwitcher.update(sample);
+                predictorSwitcher.predict(PREDICTION_HORIZON, prediction);
+            }
+
+            if (resetPredictionError)
+            {
+                predictionError.reset();
+                resetPredictionError = false;
+            }
+
+            // score predictions that have reached their target time against the
+            // measured position, then queue this one as the predictor made it (the
+            // statistics measure the predictor, as TraceEvaluator does)
+            predictionError.update(time, rawPosition);
+            predictionError.push(time + PREDICTION_HORIZON, prediction.m_position);
+
+            // nothing rendered (indicator, trails, scope, forces) uses a position the
+            // device cannot reach
+            workspaceBound.constrain(prediction);
+
+            linearVelocity.set(prediction.m_velocity[0], prediction.m_velocity[1], prediction.m_velocity[2]);
+            predictedPosition.set(prediction.m_position[0], prediction.m_position[1], prediction.m_position[2]);
+
+            // extend the trails (drawn by the graphics thread)
+            if (showTrails && !watchdog.isShed(SHED_VISUAL))
+            {
+                actualTrail->push(position);
+                predictedTrail->push(predictedPosition);
+            }
+
+            // feed the velocity scope (drawn by the graphics thread)
+            if (scopeAxis >= 0 && !watchdog.isShed(SHED_VISUAL))
+            {
+                float velocities[6];
+                for (int i = 0; i < 3; i++)
+                {
+                    velocities[i] = (float)rawVelocity[i];
+                    velocities[3 + i] = (float)prediction.m_velocity[i];
+                }
+                velocityScope->push(velocities);
+            }
+
+            // update prediction frequency counter
+            predictFrequencyCounter.signal(1);
         }
 
-        // read angular velocity
-        cVector3d angularVelocity;
-        hapticDevice->getAngularVelocity(angularVelocity);
-
-        // read gripper angular velocity
-        double gripperAngularVelocity;
-        hapticDevice->getGripperAngularVelocity(gripperAngularVelocity);
-
-        // read user-switch status (button 0)
-        bool button0, button1, button2, button3;
-        button0 = false;
-        button1 = false;
-        button2 = false;
-        button3 = false;
-
-        hapticDevice->getUserSwitch(0, button0);
-        hapticDevice->getUserSwitch(1, button1);
-        hapticDevice->getUserSwitch(2, button2);
-        hapticDevice->getUserSwitch(3, button3);
-
 
         /////////////////////////////////////////////////////////////////////
         // UPDATE 3D CURSOR MODEL
         /////////////////////////////////////////////////////////////////////
-       
-        // update arrow
-        velocity->m_pointA = position;
-        velocity->m_pointB = cAdd(position, linearVelocity);
-
-        // update position and orientation of cursor
-        cursor->setLocalPos(position);
-        cursor->setLocalRot(rotation);
-
-        // update predicted position indicator
-        predictIndicator->setLocalPos(cAdd(position, linearVelocity));
 
-        // adjust the  color of the cursor according to the status of
-        // the user-switch (ON = TRUE / OFF = FALSE)
-        if (button0)
+        if (scheduler.isDue(stageScene, time) && !watchdog.isShed(SHED_VISUAL))
         {
-            cursor->m_material->setGreenMediumAquamarine(); 
+            // read orientation 
+            cMatrix3d rotation;
+            hapticDevice->getRotation(rotation);
+
+            // read user-switch status (button 0)
+            bool button0, button1, button2, button3;
+            button0 = false;
+            button1 = false;
+            button2 = false;
+            button3 = false;
+
+            hapticDevice->getUserSwitch(0, button0);
+            hapticDevice->getUserSwitch(1, button1);
+            hapticDevice->getUserSwitch(2, button2);
+            hapticDevice->getUserSwitch(3, button3);
+
+            // update arrow
+            velocity->m_pointA = position;
+            velocity->m_pointB = cAdd(position, linearVelocity);
+
+            // update position and orientation of cursor
+            cursor->setLocalPos(position);
+            cursor->setLocalRot(rotation);
+
+            // update predicted position indicator
+            predictIndicator->setLocalPos(predictedPosition);
+
+            // adjust the  color of the cursor according to the status of
+            // the user-switch (ON = TRUE / OFF = FALSE)
+            if (button0)
+            {
+                cursor->m_material->setGreenMediumAquamarine(); 
+            }
+            else if (button1)
+            {
+                cursor->m_material->setYellowGold();
+            }
+            else if (button2)
+            {
+                cursor->m_material->setOrangeCoral();
+            }
+            else if (button3)
+            {
+                cursor->m_material->setPurpleLavender();
+            }
+            else
+            {
+                cursor->m_material->setBlueRoyal();
+            }
+
+            // update global variable for graphic display update
+            hapticDevicePosition = position;
         }
-        else if (button1)
-        {
-            cursor->m_material->setYellowGold();
-        }
-        else if (button2)
+
+        /////////////////////////////////////////////////////////////////////
+        // COMPUTE AND APPLY FORCES
+        /////////////////////////////////////////////////////////////////////
+
+        if (scheduler.isDue(stageForce, time))
         {
-            cursor->m_material->setOrangeCoral();
+            double forceStart = CostMeter::now();
+
+            // position the field acts on: as measured, or where the device will be when
+            // the force takes effect, extrapolated with the measured velocity (not the
+            // display predictor's, which is clamped, stopped and bounded); damping always
+            // acts on the measured velocity
+            int mode = forceMode.load();
+            double Kp = forceStiffness.load(); // [N/m]
+            cVector3d forcePosition = position;
+            cVector3d forceVelocity = deviceVelocity;
+            if (mode == FORCE_PREDICTIVE)
+            {
+                forcePosition = cAdd(position, cMul(FORCE_LATENCY, deviceVelocity));
+            }
+
+            // desired position
+            cVector3d desiredPosition;
+            desiredPosition.set(0.0, 0.0, 0.0);
+
+            // desired orientation
+            cMatrix3d desiredRotation;
+            desiredRotation.identity();
+
+            // variables for forces
+            cVector3d force (0,0,0);
+            cVector3d torque (0,0,0);
+            double gripperForce = 0.0;
+
+            // apply force field
+            if (useForceField && (mode != FORCE_OFF))
+            {
+                // compute linear force
+                cVector3d forceField = Kp * (desiredPosition - forcePosition);
+                force.add(forceField);
+
+                // compute angular torque
+                cMatrix3d rotation;
+                hapticDevice->getRotation(rotation);
+
+                double Kr = 0.05; // [N/m.rad]
+                cVector3d axis;
+                double angle;
+                cMatrix3d deltaRotation = cTranspose(rotation) * desiredRotation;
+                deltaRotation.toAxisAngle(axis, angle);
+                torque = rotation * ((Kr * angle) * axis);
+            }
+
+            // apply damping term
+            if (useDamping && (mode != FORCE_OFF))
+            {
+                cVector3d angularVelocity;
+                double gripperAngularVelocity;
+                hapticDevice->getAngularVelocity(angularVelocity);
+                hapticDevice->getGripperAngularVelocity(gripperAngularVelocity);
+
+                // compute linear damping force
+                double Kv = 1.0 * hapticDeviceInfo.m_maxLinearDamping;
+                cVector3d forceDamping = -Kv * forceVelocity;
+                force.add(forceDamping);
+
+                // compute angular damping force
+                double Kvr = 1.0 * hapticDeviceInfo.m_maxAngularDamping;
+                cVector3d torqueDamping = -Kvr * angularVelocity;
+                torque.add(torqueDamping);
+
+                // compute gripper angular damping force
+                double Kvg = 1.0 * hapticDeviceInfo.m_maxGripperAngularDamping;
+                gripperForce = gripperForce - Kvg * gripperAngularVelocity;
+            }
+
+            // send computed force, torque, and gripper force to haptic device
+            // (zero when forces are off, so switching them off releases the device)
+            hapticDevice->setForceAndTorqueAndGripperForce(force, torque, gripperForce);
+
+            // chatter: a large axis force reversing from one force tick to the next
+            double chatterForce = CHATTER_FORCE * hapticDeviceInfo.m_maxLinearForce;
+            for (int i = 0; i < 3; i++)
+            {
+                if ((force(i) * lastForce(i) < 0.0) && (cAbs(force(i)) > chatterForce) && (cAbs(lastForce(i)) > chatterForce))
+                {
+                    forceChatter++;
+                    break;
+                }
+            }
+            lastForce = force;
+
+            // a stiffness counts as stable in a mode once it has rendered the field for
+            // STABLE_TIME without chatter; any change or chatter starts the time again
+            unsigned long long chatter = forceChatter.load();
+            if (!useForceField || mode != heldMode || Kp != heldStiffness || chatter != heldChatter)
+            {
+                heldMode = useForceField ? mode : FORCE_OFF;
+                heldStiffness = Kp;
+                heldChatter = chatter;
+                heldSince = time;
+            }
+            else if (heldMode != FORCE_OFF && time - heldSince >= STABLE_TIME && Kp > stableStiffness[heldMode].load())
+            {
+                stableStiffness[heldMode].store(Kp);
+            }
+
+            forceCost.add(CostMeter::now() - forceStart);
         }
-        else if (button3)
+
+
+        /////////////////////////////////////////////////////////////////////
+        // RECORD TRACE
+        /////////////////////////////////////////////////////////////////////
+
+        if (scheduler.isDue(stageRecord, time) && traceWriter.isRecording())
         {
-            cursor->m_material->setPurpleLavender();
+            TraceSample sample;
+            sample.m_time = time;
+            for (int i = 0; i < 3; i++)
+            {
+                sample.m_position[i] = rawPosition[i];
+                sample.m_velocity[i] = rawVelocity[i];
+            }
+
+            cMatrix3d rotation;
+            hapticDevice->getRotation(rotation);
+            for (int i = 0; i < 3; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    sample.m_rotation[3 * i + j] = rotation(i, j);
+                }
+            }
+
+            hapticDevice->getGripperAngleRad(sample.m_gripperAngle);
+
+            sample.m_buttons = 0;
+            for (int n = 0; n < 4; n++)
+            {
+                bool button = false;
+                hapticDevice->getUserSwitch(n, button);
+                if (button) { sample.m_buttons |= (1u << n); }
+            }
+
+            // only copies into the ring; encoding and disk writes happen on the writer thread
+            traceWriter.push(sample);
         }
-        else
+
+
+        /////////////////////////////////////////////////////////////////////
+        // PUBLISH STATISTICS
+        /////////////////////////////////////////////////////////////////////
+
+        if (scheduler.isDue(stagePublish, time) && !watchdog.isShed(SHED_VISUAL))
         {
-            cursor->m_material->setBlueRoyal();
+            predictionError.publish();
+
+            // threshold predictor in use, for its counters and the state behind the
+            // messages of keys 3 and 4 (one being warmed up belongs to the warm-up thread)
+            const MotionPredictor* active = predictorSwitcher.getVariant(predictorSwitcher.getActive());
+            const ThresholdPredictor* running = NULL;
+            if (active == &thresholdPredictor) { running = &thresholdPredictor; }
+            else if (active == &ensemblePredictor) { running = &ensembleThreshold; }
+
+            // refresh the metrics kept elsewhere (the exporter only reads the slots)
+            const int thread = METRICS_HAPTIC_THREAD;
+            PredictionErrorSummary error = predictionError.getSummary();
+            for (int i = 0; i < 3; i++)
+            {
+                if (running != NULL)
+                {
+                    metrics.set(thread, metricJitterRejections[i], (double)running->getJitterRejections(i));
+                    metrics.set(thread, metricClampHits[i], (double)running->getClampHits(i));
+                }
+                metrics.set(thread, metricErrorRmse[i], error.m_rmse[i]);
+                metrics.set(thread, metricErrorP95[i], error.m_p95[i]);
+            }
+            metrics.set(thread, metricRate[0], frequencyCounter.getFrequency());
+            metrics.set(thread, metricRate[1], predictFrequencyCounter.getFrequency());
+            metrics.set(thread, metricMissed[0], (double)scheduler.getMissed(stageRead));
+            metrics.set(thread, metricMissed[1], (double)scheduler.getMissed(stagePredict));
+            metrics.set(thread, metricOverruns, (double)watchdog.getOverruns());
+            metrics.set(thread, metricDegradations[0], (double)watchdog.getEvents(SHED_VISUAL));
+            metrics.set(thread, metricDegradations[1], (double)watchdog.getEvents(SHED_SECONDARY));
+            metrics.set(thread, metricErrorsDropped, (double)error.m_dropped);
+            metrics.set(thread, metricWorkspaceViolations, (double)workspaceBound.getViolations());
+            metrics.set(thread, metricTraceSamples, (double)traceWriter.getSamples());
+            metrics.set(thread, metricTraceDropped, (double)traceWriter.getDropped());
+            metrics.set(thread, metricForceCost, forceCost.getAverage());
+            metrics.set(thread, metricForceChatter, (double)forceChatter.load());
+
+            if (running != NULL)
+            {
+                publishedSgLag.store(running->getSavitzkyGolayLag());
+                publishedJitterThreshold.store(running->getAdaptiveThreshold().getJitterThreshold(0));
+                publishedStopThreshold.store(running->getAdaptiveThreshold().getStopThreshold());
+            }
         }
 
-        // update global variable for graphic display update
-        hapticDevicePosition = position;
-
-//        /////////////////////////////////////////////////////////////////////
-//        // COMPUTE AND APPLY FORCES
-//        /////////////////////////////////////////////////////////////////////
-
-//        // desired position
-//        cVector3d desiredPosition;
-//        desiredPosition.set(0.0, 0.0, 0.0);
-
-//        // desired orientation
-//        cMatrix3d desiredRotation;
-//        desiredRotation.identity();
-        
-//        // variables for forces
-//        cVector3d force (0,0,0);
-//        cVector3d torque (0,0,0);
-//        double gripperForce = 0.0;
-
-//        // apply force field
-//        if (useForceField)
-//        {
-//            // compute linear force
-//            double Kp = 25; // [N/m]
-//            cVector3d forceField = Kp * (desiredPosition - position);
-//            force.add(forceField);
-
-//            // compute angular torque
-//            double Kr = 0.05; // [N/m.rad]
-//            cVector3d axis;
-//            double angle;
-//            cMatrix3d deltaRotation = cTranspose(rotation) * desiredRotation;
-//            deltaRotation.toAxisAngle(axis, angle);
-//            torque = rotation * ((Kr * angle) * axis);
-//        }
-    
-//        // apply damping term
-//        if (useDamping)
-//        {
-//            cHapticDeviceInfo info = hapticDevice->getSpecifications();
-
-//            // compute linear damping force
-//            double Kv = 1.0 * info.m_maxLinearDamping;
-//            cVector3d forceDamping = -Kv * linearVelocity;
-//            force.add(forceDamping);
-
-//            // compute angular damping force
-//            double Kvr = 1.0 * info.m_maxAngularDamping;
-//            cVector3d torqueDamping = -Kvr * angularVelocity;
-//            torque.add(torqueDamping);
-
-//            // compute gripper angular damping force
-//            double Kvg = 1.0 * info.m_maxGripperAngularDamping;
-//            gripperForce = gripperForce - Kvg * gripperAngularVelocity;
-//        }
-
-//        // send computed force, torque, and gripper force to haptic device
-//        hapticDevice->setForceAndTorqueAndGripperForce(force, torque, gripperForce);
-
-        // reset predict location if velocity low
-        if ( abs(cx) + abs(cy) +abs(cz) < .001){
-            predictIndicator->setLocalPos(position);
-            cx = 0.0;
-            cy = 0.0;
-            cz = 0.0;
-        }
 
-        // update frequency counter
-        frequencyCounter.signal(1);
+        /////////////////////////////////////////////////////////////////////
+        // CHECK DEADLINE
+        /////////////////////////////////////////////////////////////////////
+
+        // shed or restore optional work depending on the duration of this tick
+        double tickDuration = clock.getCurrentTimeSeconds() - time;
+        watchdog.endTick(tickDuration);
+
+        // no parameter block is held past this point
+        predictorParameters.quiescent();
+
+        // tick count and latency distribution (two slot updates)
+        metrics.add(METRICS_HAPTIC_THREAD, metricTicks);
+        metrics.observe(METRICS_HAPTIC_THREAD, metricTickSeconds, tickDuration);
     }
     
+    // release the device
+    hapticDevice->setForceAndTorqueAndGripperForce(cVector3d(0,0,0), cVector3d(0,0,0), 0.0);
+
     // exit haptics thread
     simulationFinished = true;
 }
 
 //------------------------------------------------------------------------------
+
+void registerMetrics(void)
+{
+    const char* axis[3] = { "axis=\"x\"", "axis=\"y\"", "axis=\"z\"" };
+
+    metricTicks = metrics.addCounter("haptic_ticks_total", "Haptic loop ticks (device reads).");
+    metricTickSeconds = metrics.addSummary("haptic_tick_seconds", "Duration of a haptic loop tick.");
+    metricRate[0] = metrics.addGauge("haptic_stage_rate_hz", "Measured rate of a haptic loop stage.", "stage=\"read\"");
+    metricRate[1] = metrics.addGauge("haptic_stage_rate_hz", "Measured rate of a haptic loop stage.", "stage=\"predict\"");
+    metricMissed[0] = metrics.addCounter("haptic_stage_missed_total", "Slots a stage skipped because the loop was late.", "stage=\"read\"");
+    metricMissed[1] = metrics.addCounter("haptic_stage_missed_total", "Slots a stage skipped because the loop was late.", "stage=\"predict\"");
+    metricOverruns = metrics.addCounter("haptic_tick_overruns_total", "Ticks over their budget.");
+    metricDegradations[0] = metrics.addCounter("haptic_degradation_events_total", "Times a degradation level was entered.", "level=\"1\"");
+    metricDegradations[1] = metrics.addCounter("haptic_degradation_events_total", "Times a degradation level was entered.", "level=\"2\"");
+    for (int i = 0; i < 3; i++)
+    {
+        metricJitterRejections[i] = metrics.addCounter("prediction_jitter_rejections_total", "Velocity changes held back as jitter.", axis[i]);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        metricClampHits[i] = metrics.addCounter("prediction_velocity_clamps_total", "Velocities clamped to the axis limit.", axis[i]);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        metricErrorRmse[i] = metrics.addGauge("prediction_error_rmse_meters", "RMS prediction error at the horizon.", axis[i]);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        metricErrorP95[i] = metrics.addGauge("prediction_error_p95_meters", "95th percentile prediction error at the horizon.", axis[i]);
+    }
+    metricErrorsDropped = metrics.addCounter("prediction_errors_dropped_total", "Predictions dropped before they could be scored.");
+    metricWorkspaceViolations = metrics.addCounter("prediction_workspace_violations_total", "Predictions moved back into the device workspace.");
+    metricTraceSamples = metrics.addCounter("trace_samples_total", "Samples written to the trace.");
+    metricTraceDropped = metrics.addCounter("trace_samples_dropped_total", "Samples lost because the trace writer fell behind.");
+    metricForceCost = metrics.addGauge("force_stage_seconds", "Average cost of the force stage.");
+    metricForceChatter = metrics.addCounter("force_chatter_ticks_total", "Force ticks where a large force reversed (unstable field).");
+}
+
+//------------------------------------------------------------------------------
+
+void reloadParameters(void)
+{
+    PredictorParameters parameters;
+    string error;
+    if (loadPredictorParameters(PARAMETER_FILE, parameters, error))
+    {
+        // a median window the file changes replaces the one of key 7, otherwise key 7 keeps it
+        static int fileMedianWindow = 0;
+        if (parameters.m_medianWindow > 0 && parameters.m_medianWindow != fileMedianWindow)
+        {
+            fileMedianWindow = parameters.m_medianWindow;
+            optionMedianWindow.store(fileMedianWindow);
+            optionVersion++;
+        }
+        predictorParameters.publish(new PredictorParameters(parameters));
+        cout << "> Loaded " << PARAMETER_FILE << "                            \r";
+    }
+    else
+    {
+        cout << "> " << PARAMETER_FILE << ": " << error << " (parameters unchanged)" << endl;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool selectPredictor(const char* a_name)
+{
+    // both ensemble modes are the same variant; the mode applies at once
+    string name = a_name;
+    int variant;
+    if (name == "ensemble-best" || name == "ensemble-blend")
+    {
+        ensemblePredictor.setMode((name == "ensemble-best") ? EnsemblePredictor::ENSEMBLE_SELECT_BEST : EnsemblePredictor::ENSEMBLE_BLEND);
+        variant = ensembleVariant;
+    }
+    else
+    {
+        variant = predictorSwitcher.findVariant(a_name);
+    }
+
+    return predictorSwitcher.requestSwitch(variant);
+}
+
+//------------------------------------------------------------------------------
+
+void configureThreshold(const PredictorParameters& a_parameters, ThresholdPredictor& a_predictor)
+{
+    applyPredictorParameters(a_parameters, a_predictor);
+    a_predictor.setUseSavitzkyGolay(optionSavitzkyGolay.load());
+    a_predictor.setUseAdaptiveThreshold(optionAdaptiveThreshold.load());
+    a_predictor.setMedianWindow(optionMedianWindow.load());
+}
+
+//------------------------------------------------------------------------------
+
+void configurePredictor(MotionPredictor* a_variant)
+{
+    // the block stays valid until the next quiescent state of the haptic thread
+    const PredictorParameters& parameters = *predictorParameters.read();
+    if (a_variant == &thresholdPredictor)
+    {
+        configureThreshold(parameters, thresholdPredictor);
+    }
+    else if (a_variant == &runningAveragePredictor)
+    {
+        applyPredictorParameters(parameters, runningAveragePredictor);
+    }
+    else if (a_variant == &sgPredictor)
+    {
+        applyPredictorParameters(parameters, sgPredictor);
+    }
+    else if (a_variant == &abgPredictor)
+    {
+        applyPredictorParameters(parameters, abgPredictor);
+    }
+    else if (a_variant == &rlsPredictor)
+    {
+        applyPredictorParameters(parameters, rlsPredictor);
+    }
+    else if (a_variant == &learnedPredictor)
+    {
+        applyPredictorParameters(parameters, learnedPredictor);
+    }
+    else if (a_variant == &ensemblePredictor)
+    {
+        configureThreshold(parameters, ensembleThreshold);
+        applyPredictorParameters(parameters, ensembleRunningAverage);
+        applyPredictorParameters(parameters, ensembleSg);
+    }
+}
+
+//------------------------------------------------------------------------------
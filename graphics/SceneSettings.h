@@ -0,0 +1,31 @@
+//==============================================================================
+/*
+    SceneSettings.h
+
+    Settings of the threshold program's scene that the tools reproducing
+    that scene (RenderBenchmark) must share with it: the prediction
+    horizon, the rate at which the scene is updated and the sizes of the
+    trails and the velocity scope.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef SceneSettingsH
+#define SceneSettingsH
+//------------------------------------------------------------------------------
+
+// prediction horizon [s] (predicted position = position + horizon * velocity)
+const double PREDICTION_HORIZON = 1.0;
+
+// rate [Hz] of the cursor, indicator and button updates for display
+const double SCENE_RATE = 60.0;
+
+// points kept in the actual and predicted trails (4 s at 1 kHz predictions)
+const int TRAIL_POINTS = 4096;
+
+// samples shown by the velocity scope (4 s at 1 kHz predictions)
+const int SCOPE_HISTORY = 4000;
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,225 @@
+//==============================================================================
+/*
+    ScopePlot.h
+
+    Scrolling oscilloscope for the front layer of a camera, plotting signals
+    sampled by the haptic thread at its own rate.
+
+    The haptic thread pushes one sample of all channels at a time through a
+    lock-free ring; the graphics thread drains it into a history of the
+    last HISTORY samples when the plot is rendered. The history is reduced
+    to the plot width by min/max decimation: each pixel column covers a
+    fixed run of samples and draws the range they span, so a spike shorter
+    than a column still shows. Runs are aligned to the absolute sample
+    count, so columns do not shimmer while the plot scrolls.
+
+    Coordinates are pixels of the front layer, the origin being the lower
+    left corner of the plot (its local position).
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef ScopePlotH
+#define ScopePlotH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "prediction/LaneKernels.h"
+#include "prediction/SpscRing.h"
+#include <vector>
+//------------------------------------------------------------------------------
+
+template <int CHANNELS, int HISTORY>
+class ScopePlot : public chai3d::cGenericObject
+{
+public:
+
+    // reference lines drawn across the plot
+    static const int MAX_MARKERS = 4;
+
+    // a_range: values in [-a_range, a_range] fill the plot height
+    ScopePlot(double a_range) : m_history(CHANNELS * HISTORY, 0.0f)
+    {
+        m_range = (float)a_range;
+        m_width = 400;
+        m_height = 100;
+        m_numMarkers = 0;
+        m_total = 0;
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            m_shown[c] = true;
+            m_color[c] = chai3d::cColorf(1.0f, 1.0f, 1.0f);
+        }
+    }
+
+    // the ring is cache-line aligned, which plain new does not honour before C++17
+    static void* operator new(size_t a_size) { return allocateAligned(a_size, alignof(ScopePlot)); }
+    static void operator delete(void* a_memory) { freeAligned(a_memory); }
+
+    // append one value per channel (haptic thread); samples beyond the ring capacity are dropped
+    void push(const float a_values[CHANNELS])
+    {
+        Sample sample;
+        for (int c = 0; c < CHANNELS; c++) { sample.m_value[c] = a_values[c]; }
+        m_pending.push(sample);
+    }
+
+    // plot size [pixels] (graphics thread)
+    void setSize(int a_width, int a_height)
+    {
+        m_width = a_width;
+        m_height = a_height;
+    }
+
+    void setChannelColor(int a_channel, const chai3d::cColorf& a_color) { m_color[a_channel] = a_color; }
+    void setChannelShown(int a_channel, bool a_shown) { m_shown[a_channel] = a_shown; }
+
+    // horizontal reference line at a_value (e.g. a threshold)
+    void addMarker(double a_value)
+    {
+        if (m_numMarkers < MAX_MARKERS) { m_marker[m_numMarkers++] = (float)a_value; }
+    }
+
+    // samples lost because the graphics thread did not drain the ring in time
+    unsigned long long getDropped() const { return m_pending.getDropped(); }
+
+protected:
+
+    struct Sample
+    {
+        float m_value[CHANNELS];
+    };
+
+    virtual void render(chai3d::cRenderOptions& a_options)
+    {
+#ifdef C_USE_OPENGL
+        if (!SECTION_RENDER_OPAQUE_PARTS_ONLY(a_options)) { return; }
+
+        drain();
+
+        glDisable(GL_LIGHTING);
+        glLineWidth(1.0f);
+        glEnableClientState(GL_VERTEX_ARRAY);
+
+        // frame, zero line and markers
+        float width = (float)m_width;
+        float height = (float)m_height;
+        float frame[8] = { 0, 0, width, 0, width, height, 0, height };
+        glColor4f(0.5f, 0.5f, 0.5f, 1.0f);
+        glVertexPointer(2, GL_FLOAT, 0, frame);
+        glDrawArrays(GL_LINE_LOOP, 0, 4);
+
+        m_vertices.clear();
+        addLine(0.0f);
+        for (int m = 0; m < m_numMarkers; m++) { addLine(m_marker[m]); }
+        glColor4f(0.3f, 0.3f, 0.3f, 1.0f);
+        glVertexPointer(2, GL_FLOAT, 0, &m_vertices[0]);
+        glDrawArrays(GL_LINES, 0, (GLsizei)(m_vertices.size() / 2));
+
+        // one strip per channel through the (min, max) pair of every column
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            if (!m_shown[c] || !decimate(c)) { continue; }
+
+            glColor4fv(m_color[c].getData());
+            glVertexPointer(2, GL_FLOAT, 0, &m_vertices[0]);
+            glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)(m_vertices.size() / 2));
+        }
+
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glEnable(GL_LIGHTING);
+#endif
+    }
+
+    // the plot is not part of any collision or camera fit
+    virtual void updateBoundaryBox()
+    {
+        m_boundaryBoxMin.zero();
+        m_boundaryBoxMax.zero();
+    }
+
+private:
+
+    void drain()
+    {
+        Sample sample;
+        while (m_pending.pop(sample))
+        {
+            float* values = &m_history[CHANNELS * (int)(m_total % HISTORY)];
+            for (int c = 0; c < CHANNELS; c++) { values[c] = sample.m_value[c]; }
+            m_total++;
+        }
+    }
+
+    // vertical pixel coordinate of a value, clamped to the plot
+    float toPixel(float a_value) const
+    {
+        float y = 0.5f * (float)m_height * (1.0f + a_value / m_range);
+        return (y < 0.0f) ? 0.0f : (y > (float)m_height) ? (float)m_height : y;
+    }
+
+    void addLine(float a_value)
+    {
+        float y = toPixel(a_value);
+        float line[4] = { 0.0f, y, (float)m_width, y };
+        m_vertices.insert(m_vertices.end(), line, line + 4);
+    }
+
+    // fill m_vertices with the min/max strip of a channel, false if there is nothing to draw
+    bool decimate(int a_channel)
+    {
+        m_vertices.clear();
+        if (m_total == 0 || m_width < 1) { return false; }
+
+        // samples per column, columns aligned to multiples of the sample count
+        int run = (HISTORY + m_width - 1) / m_width;
+        float columnWidth = (float)m_width * run / HISTORY;
+
+        unsigned long long first = (m_total > HISTORY) ? m_total - HISTORY : 0;
+        unsigned long long last = m_total - 1;
+        unsigned long long lastColumn = last / run;
+        unsigned long long firstColumn = (first + run - 1) / run;
+
+        for (unsigned long long column = firstColumn; column <= lastColumn; column++)
+        {
+            unsigned long long begin = column * run;
+            unsigned long long end = (column == lastColumn) ? m_total : begin + run;
+
+            float low = m_history[CHANNELS * (int)(begin % HISTORY) + a_channel];
+            float high = low;
+            for (unsigned long long n = begin + 1; n < end; n++)
+            {
+                float value = m_history[CHANNELS * (int)(n % HISTORY) + a_channel];
+                low = (value < low) ? value : low;
+                high = (value > high) ? value : high;
+            }
+
+            // newest column at the right edge
+            float x = (float)m_width - (float)(lastColumn - column) * columnWidth;
+            float pair[4] = { x, toPixel(low), x, toPixel(high) };
+            m_vertices.insert(m_vertices.end(), pair, pair + 4);
+        }
+        return true;
+    }
+
+    // samples handed over by the haptic thread
+    SpscRing<Sample, 4096> m_pending;
+
+    // last HISTORY samples, interleaved by channel (graphics thread)
+    std::vector<float> m_history;
+    unsigned long long m_total;
+
+    // scratch vertices of the current draw call
+    std::vector<float> m_vertices;
+
+    float m_range;
+    int m_width;
+    int m_height;
+    bool m_shown[CHANNELS];
+    chai3d::cColorf m_color[CHANNELS];
+    float m_marker[MAX_MARKERS];
+    int m_numMarkers;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,192 @@
+//==============================================================================
+/*
+    TrailMesh.h
+
+    Fixed-capacity line strip showing the recent path of a point, drawn with
+    one draw call however long the trail is.
+
+    Points are pushed by the haptic thread through a lock-free ring and
+    drained when the graphics thread renders the trail. The vertex buffer
+    holds every point twice, at slot s and at slot s + CAPACITY, so the
+    last CAPACITY points are always contiguous somewhere in the buffer and
+    the oldest point never has to move: a frame uploads only the vertices
+    added since the previous frame (glBufferSubData) and draws the window
+    [oldest, oldest + count) as a single GL_LINE_STRIP.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef TrailMeshH
+#define TrailMeshH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "prediction/LaneKernels.h"
+#include "prediction/SpscRing.h"
+#include <atomic>
+#include <vector>
+//------------------------------------------------------------------------------
+
+template <int CAPACITY>
+class TrailMesh : public chai3d::cGenericObject
+{
+public:
+
+    TrailMesh(const chai3d::cColorf& a_color, float a_lineWidth = 1.0f) :
+        m_color(a_color), m_lineWidth(a_lineWidth), m_vertices(6 * CAPACITY, 0.0f)
+    {
+        m_total = 0;
+        m_uploaded = 0;
+        m_buffer = 0;
+        m_clear.store(false);
+    }
+
+    // the vertex buffer is freed with the trail (like the textures of CHAI3D)
+    virtual ~TrailMesh()
+    {
+#ifdef C_USE_OPENGL
+        if (m_buffer != 0) { glDeleteBuffers(1, &m_buffer); }
+#endif
+    }
+
+    // the ring is cache-line aligned, which plain new does not honour before C++17
+    static void* operator new(size_t a_size) { return allocateAligned(a_size, alignof(TrailMesh)); }
+    static void operator delete(void* a_memory) { freeAligned(a_memory); }
+
+    // append a point (haptic thread); points beyond the ring capacity are dropped
+    void push(const chai3d::cVector3d& a_position)
+    {
+        Point point = { { (float)a_position.get(0), (float)a_position.get(1), (float)a_position.get(2) } };
+        m_pending.push(point);
+    }
+
+    // forget the trail on the next render (any thread)
+    void clear() { m_clear.store(true); }
+
+    // points currently drawn (graphics thread)
+    int getCount() const { return (m_total < CAPACITY) ? (int)m_total : CAPACITY; }
+
+    // points lost because the graphics thread did not drain the ring in time
+    unsigned long long getDropped() const { return m_pending.getDropped(); }
+
+protected:
+
+    struct Point
+    {
+        float m_position[3];
+    };
+
+    virtual void render(chai3d::cRenderOptions& a_options)
+    {
+#ifdef C_USE_OPENGL
+        if (!SECTION_RENDER_OPAQUE_PARTS_ONLY(a_options)) { return; }
+
+        drain();
+
+        // a new context (fullscreen switch) needs a new buffer holding the whole trail;
+        // the one it replaces is released first
+        if (m_buffer == 0 || a_options.m_resetDisplay)
+        {
+            if (m_buffer != 0) { glDeleteBuffers(1, &m_buffer); }
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), &m_vertices[0], GL_DYNAMIC_DRAW);
+            m_uploaded = m_total;
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            upload();
+        }
+
+        int count = getCount();
+        if (count > 1)
+        {
+            glDisable(GL_LIGHTING);
+            glLineWidth(m_lineWidth);
+            glColor4fv(m_color.getData());
+
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(3, GL_FLOAT, 0, 0);
+            glDrawArrays(GL_LINE_STRIP, (GLint)((m_total - count) % CAPACITY), count);
+            glDisableClientState(GL_VERTEX_ARRAY);
+
+            glEnable(GL_LIGHTING);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+    }
+
+    // the trail is not part of any collision or camera fit
+    virtual void updateBoundaryBox()
+    {
+        m_boundaryBoxMin.zero();
+        m_boundaryBoxMax.zero();
+    }
+
+private:
+
+    // move pending points into both copies of their slot in the shadow buffer
+    void drain()
+    {
+        if (m_clear.exchange(false))
+        {
+            m_total = 0;
+            m_uploaded = 0;
+        }
+
+        Point point;
+        while (m_pending.pop(point))
+        {
+            int slot = (int)(m_total % CAPACITY);
+            for (int i = 0; i < 3; i++)
+            {
+                m_vertices[3 * slot + i] = point.m_position[i];
+                m_vertices[3 * (slot + CAPACITY) + i] = point.m_position[i];
+            }
+            m_total++;
+        }
+    }
+
+    // copy the points added since the last frame to the vertex buffer
+    void upload()
+    {
+        unsigned long long first = m_uploaded;
+        if (m_total - first > CAPACITY) { first = m_total - CAPACITY; }
+        int count = (int)(m_total - first);
+        if (count == 0) { return; }
+
+        // the new points are contiguous from their first slot (at most 2 * CAPACITY - 1);
+        // their twins lie CAPACITY slots away, wrapping at the end of the buffer
+        int slot = (int)(first % CAPACITY);
+        uploadRange(slot, count);
+        int head = (slot + count < CAPACITY) ? count : CAPACITY - slot;
+        uploadRange(slot + CAPACITY, head);
+        if (head < count) { uploadRange(0, count - head); }
+
+        m_uploaded = m_total;
+    }
+
+    void uploadRange(int a_slot, int a_count)
+    {
+#ifdef C_USE_OPENGL
+        glBufferSubData(GL_ARRAY_BUFFER, 3 * a_slot * sizeof(float), 3 * a_count * sizeof(float), &m_vertices[3 * a_slot]);
+#endif
+    }
+
+    chai3d::cColorf m_color;
+    float m_lineWidth;
+
+    // points handed over by the haptic thread
+    SpscRing<Point, 4096> m_pending;
+    std::atomic<bool> m_clear;
+
+    // doubled shadow copy of the vertex buffer (graphics thread)
+    std::vector<float> m_vertices;
+    unsigned long long m_total;
+    unsigned long long m_uploaded;
+    GLuint m_buffer;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
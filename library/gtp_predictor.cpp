@@ -0,0 +1,218 @@
+//==============================================================================
+/*
+    gtp_predictor.cpp
+
+    C interface to the predictors of prediction/. Each predictor type is a
+    holder class constructed with placement new in the caller's storage;
+    the ensemble holder also contains the members the ensemble runs.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#define GTP_BUILDING
+#include "gtp_predictor.h"
+#include "prediction/AlphaBetaGammaPredictor.h"
+#include "prediction/EnsemblePredictor.h"
+#include "prediction/PredictorParameters.h"
+#include "prediction/Predictors.h"
+#include "prediction/RlsArPredictor.h"
+#include <new>
+#include <stdint.h>
+//------------------------------------------------------------------------------
+
+struct gtp_predictor
+{
+    virtual ~gtp_predictor() {}
+
+    virtual MotionPredictor& getPredictor() = 0;
+    virtual const MotionPredictor& getPredictor() const = 0;
+    virtual void apply(const PredictorParameters& a_parameters) = 0;
+
+    // horizon [s] at which ensemble members are scored (ignored by single predictors)
+    virtual void setScoreHorizon(double a_scoreHorizon) { (void)a_scoreHorizon; }
+};
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+// a single predictor
+template <typename PREDICTOR>
+struct SingleHolder : public gtp_predictor
+{
+    virtual MotionPredictor& getPredictor() { return m_predictor; }
+    virtual const MotionPredictor& getPredictor() const { return m_predictor; }
+    virtual void apply(const PredictorParameters& a_parameters) { applyPredictorParameters(a_parameters, m_predictor); }
+
+    PREDICTOR m_predictor;
+};
+
+// an ensemble with its members (threshold, running average and Savitzky-Golay)
+struct EnsembleHolder : public gtp_predictor
+{
+    EnsembleHolder(double a_scoreHorizon, EnsemblePredictor::Mode a_mode) : m_ensemble(a_scoreHorizon)
+    {
+        m_ensemble.addMember(&m_threshold);
+        m_ensemble.addMember(&m_runningAverage);
+        m_ensemble.addMember(&m_savitzkyGolay);
+        m_ensemble.setMode(a_mode);
+    }
+
+    virtual MotionPredictor& getPredictor() { return m_ensemble; }
+    virtual const MotionPredictor& getPredictor() const { return m_ensemble; }
+    virtual void setScoreHorizon(double a_scoreHorizon) { m_ensemble.setScoreHorizon(a_scoreHorizon); }
+
+    virtual void apply(const PredictorParameters& a_parameters)
+    {
+        applyPredictorParameters(a_parameters, m_threshold);
+        applyPredictorParameters(a_parameters, m_runningAverage);
+        applyPredictorParameters(a_parameters, m_savitzkyGolay);
+    }
+
+    ThresholdPredictor m_threshold;
+    RunningAveragePredictor m_runningAverage;
+    SavitzkyGolayPredictor m_savitzkyGolay;
+    EnsemblePredictor m_ensemble;
+};
+
+// C parameters to the parameter block of the programs, false if one is out of range
+bool convertParameters(const gtp_parameters* a_parameters, PredictorParameters& a_converted)
+{
+    if (a_parameters == NULL) { return true; }
+
+    bool valid = (a_parameters->jitter_threshold > 0.0 && a_parameters->stop_threshold > 0.0 &&
+                  a_parameters->average_cycle >= 2 && a_parameters->average_cycle <= 10000 &&
+                  a_parameters->score_horizon >= 0.0 && a_parameters->tracker_memory > 0.0 &&
+                  a_parameters->rls_forgetting > 0.0 && a_parameters->rls_forgetting <= 1.0 &&
+                  (a_parameters->median_window == 1 || a_parameters->median_window == 3 ||
+                   a_parameters->median_window == 5 || a_parameters->median_window == 7));
+    for (int i = 0; i < 3; i++)
+    {
+        valid = valid && (a_parameters->velocity_limit[i] > 0.0);
+        a_converted.m_velocityLimit[i] = a_parameters->velocity_limit[i];
+    }
+    a_converted.m_jitterThreshold = a_parameters->jitter_threshold;
+    a_converted.m_stopThreshold = a_parameters->stop_threshold;
+    a_converted.m_averageCycle = a_parameters->average_cycle;
+    a_converted.m_medianWindow = a_parameters->median_window;
+    a_converted.m_trackerMemory = a_parameters->tracker_memory;
+    a_converted.m_rlsForgetting = a_parameters->rls_forgetting;
+    return valid;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void gtp_parameters_default(gtp_parameters* a_parameters)
+{
+    PredictorParameters defaults;
+    for (int i = 0; i < 3; i++)
+    {
+        a_parameters->velocity_limit[i] = defaults.m_velocityLimit[i];
+    }
+    a_parameters->jitter_threshold = defaults.m_jitterThreshold;
+    a_parameters->stop_threshold = defaults.m_stopThreshold;
+    a_parameters->average_cycle = defaults.m_averageCycle;
+    a_parameters->score_horizon = 1.0;
+    a_parameters->median_window = 1;
+    a_parameters->tracker_memory = defaults.m_trackerMemory;
+    a_parameters->rls_forgetting = defaults.m_rlsForgetting;
+}
+
+size_t gtp_predictor_size(gtp_predictor_type a_type)
+{
+    switch (a_type)
+    {
+        case GTP_THRESHOLD:        return sizeof(SingleHolder<ThresholdPredictor>);
+        case GTP_RUNNING_AVERAGE:  return sizeof(SingleHolder<RunningAveragePredictor>);
+        case GTP_SAVITZKY_GOLAY:   return sizeof(SingleHolder<SavitzkyGolayPredictor>);
+        case GTP_ALPHA_BETA_GAMMA: return sizeof(SingleHolder<AlphaBetaGammaPredictor>);
+        case GTP_RLS_AR:           return sizeof(SingleHolder<RlsArPredictor>);
+        case GTP_ENSEMBLE_BEST:
+        case GTP_ENSEMBLE_BLEND:   return sizeof(EnsembleHolder);
+    }
+    return 0;
+}
+
+size_t gtp_predictor_alignment(void)
+{
+    size_t alignment = alignof(SingleHolder<ThresholdPredictor>);
+    if (alignof(SingleHolder<RunningAveragePredictor>) > alignment) { alignment = alignof(SingleHolder<RunningAveragePredictor>); }
+    if (alignof(SingleHolder<SavitzkyGolayPredictor>) > alignment) { alignment = alignof(SingleHolder<SavitzkyGolayPredictor>); }
+    if (alignof(SingleHolder<AlphaBetaGammaPredictor>) > alignment) { alignment = alignof(SingleHolder<AlphaBetaGammaPredictor>); }
+    if (alignof(SingleHolder<RlsArPredictor>) > alignment) { alignment = alignof(SingleHolder<RlsArPredictor>); }
+    if (alignof(EnsembleHolder) > alignment) { alignment = alignof(EnsembleHolder); }
+    return alignment;
+}
+
+gtp_predictor* gtp_predictor_create(gtp_predictor_type a_type, const gtp_parameters* a_parameters, void* a_storage, size_t a_size)
+{
+    size_t size = gtp_predictor_size(a_type);
+    if (size == 0 || a_storage == NULL || a_size < size) { return NULL; }
+    if ((uintptr_t)a_storage % gtp_predictor_alignment() != 0) { return NULL; }
+
+    PredictorParameters parameters;
+    if (!convertParameters(a_parameters, parameters)) { return NULL; }
+    double scoreHorizon = (a_parameters != NULL) ? a_parameters->score_horizon : 1.0;
+
+    gtp_predictor* predictor = NULL;
+    switch (a_type)
+    {
+        case GTP_THRESHOLD:        predictor = new (a_storage) SingleHolder<ThresholdPredictor>(); break;
+        case GTP_RUNNING_AVERAGE:  predictor = new (a_storage) SingleHolder<RunningAveragePredictor>(); break;
+        case GTP_SAVITZKY_GOLAY:   predictor = new (a_storage) SingleHolder<SavitzkyGolayPredictor>(); break;
+        case GTP_ALPHA_BETA_GAMMA: predictor = new (a_storage) SingleHolder<AlphaBetaGammaPredictor>(); break;
+        case GTP_RLS_AR:           predictor = new (a_storage) SingleHolder<RlsArPredictor>(); break;
+        case GTP_ENSEMBLE_BEST:    predictor = new (a_storage) EnsembleHolder(scoreHorizon, EnsemblePredictor::ENSEMBLE_SELECT_BEST); break;
+        case GTP_ENSEMBLE_BLEND:   predictor = new (a_storage) EnsembleHolder(scoreHorizon, EnsemblePredictor::ENSEMBLE_BLEND); break;
+    }
+    predictor->apply(parameters);
+    return predictor;
+}
+
+void gtp_predictor_destroy(gtp_predictor* a_predictor)
+{
+    if (a_predictor != NULL) { a_predictor->~gtp_predictor(); }
+}
+
+int gtp_predictor_set_parameters(gtp_predictor* a_predictor, const gtp_parameters* a_parameters)
+{
+    PredictorParameters parameters;
+    if (a_parameters == NULL || !convertParameters(a_parameters, parameters)) { return 0; }
+
+    a_predictor->apply(parameters);
+    a_predictor->setScoreHorizon(a_parameters->score_horizon);
+    return 1;
+}
+
+void gtp_predictor_reset(gtp_predictor* a_predictor)
+{
+    a_predictor->getPredictor().reset();
+}
+
+void gtp_predictor_push_sample(gtp_predictor* a_predictor, const gtp_sample* a_sample)
+{
+    MotionSample sample;
+    sample.m_time = a_sample->time;
+    for (int i = 0; i < 3; i++)
+    {
+        sample.m_position[i] = a_sample->position[i];
+        sample.m_velocity[i] = a_sample->velocity[i];
+    }
+    a_predictor->getPredictor().update(sample);
+}
+
+void gtp_predictor_predict(const gtp_predictor* a_predictor, double a_horizon, gtp_prediction* a_prediction)
+{
+    MotionPrediction prediction;
+    a_predictor->getPredictor().predict(a_horizon, prediction);
+    for (int i = 0; i < 3; i++)
+    {
+        a_prediction->position[i] = prediction.m_position[i];
+        a_prediction->velocity[i] = prediction.m_velocity[i];
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,122 @@
+/*==============================================================================
+    gtp_predictor.h
+
+    C interface to the position predictors, for control loops that do not
+    use CHAI3D or OpenGL.
+
+    The library never allocates: the caller provides the storage of each
+    predictor (static, stack or its own pool), sized and aligned as
+    gtp_predictor_size() and gtp_predictor_alignment() require, and the
+    predictor is constructed in place. Pushing a sample and predicting take
+    no locks and make no system calls, so both can run inside a real-time
+    loop. A predictor must only be used by one thread at a time.
+
+        unsigned char storage[...];   (aligned to gtp_predictor_alignment())
+        gtp_predictor* predictor = gtp_predictor_create(GTP_THRESHOLD, NULL, storage, sizeof(storage));
+        gtp_predictor_push_sample(predictor, &sample);
+        gtp_predictor_predict(predictor, 0.05, &prediction);
+        gtp_predictor_destroy(predictor);
+==============================================================================*/
+
+/*----------------------------------------------------------------------------*/
+#ifndef GTP_PREDICTOR_H
+#define GTP_PREDICTOR_H
+/*----------------------------------------------------------------------------*/
+#include <stddef.h>
+/*----------------------------------------------------------------------------*/
+
+/* symbols of the shared library */
+#if defined(_WIN32) && defined(GTP_SHARED)
+#ifdef GTP_BUILDING
+#define GTP_API __declspec(dllexport)
+#else
+#define GTP_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define GTP_API __attribute__((visibility("default")))
+#else
+#define GTP_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* predictor implementations */
+typedef enum
+{
+    GTP_THRESHOLD = 0,          /* device velocity, clamped, spikes held back by a jitter threshold */
+    GTP_RUNNING_AVERAGE = 1,    /* clamped device velocity averaged over a cycle of samples */
+    GTP_SAVITZKY_GOLAY = 2,     /* velocity differentiated from the positions */
+    GTP_ENSEMBLE_BEST = 3,      /* the three above, output of the one with the lowest recent error */
+    GTP_ENSEMBLE_BLEND = 4,     /* the three above, error-weighted blend of their outputs */
+    GTP_ALPHA_BETA_GAMMA = 5,   /* fading-memory alpha-beta-gamma tracker over the positions */
+    GTP_RLS_AR = 6              /* autoregressive velocity model refitted every sample (recursive least squares) */
+} gtp_predictor_type;
+
+/* tunable parameters, see gtp_parameters_default() */
+typedef struct
+{
+    double velocity_limit[3];   /* per-axis velocity limit [m/s] */
+    double jitter_threshold;    /* fixed jitter threshold of the threshold predictor [m/s] */
+    double stop_threshold;      /* L1 velocity below which the prediction is the position [m/s] */
+    int average_cycle;          /* running average cycle [samples] */
+    double score_horizon;       /* horizon at which ensemble members are scored [s] */
+    int median_window;          /* median prefilter of the threshold predictor: 1 (off), 3, 5 or 7 [samples] */
+    double tracker_memory;      /* fading memory of the alpha-beta-gamma tracker [s] */
+    double rls_forgetting;      /* forgetting factor of the recursive least squares fit, (0, 1] */
+} gtp_parameters;
+
+/* one device sample */
+typedef struct
+{
+    double time;                /* [s] */
+    double position[3];         /* [m] */
+    double velocity[3];         /* velocity reported by the device [m/s] */
+} gtp_sample;
+
+/* predicted state */
+typedef struct
+{
+    double position[3];         /* [m] */
+    double velocity[3];         /* [m/s] */
+} gtp_prediction;
+
+/* a predictor living in caller-owned storage */
+typedef struct gtp_predictor gtp_predictor;
+
+/* parameters the programs use by default */
+GTP_API void gtp_parameters_default(gtp_parameters* parameters);
+
+/* storage [bytes] and alignment a predictor of a given type needs (0 if the type is unknown) */
+GTP_API size_t gtp_predictor_size(gtp_predictor_type type);
+GTP_API size_t gtp_predictor_alignment(void);
+
+/* construct a predictor in storage; parameters may be NULL for the defaults;
+   returns NULL if the type is unknown, the storage too small or misaligned,
+   or a parameter out of range */
+GTP_API gtp_predictor* gtp_predictor_create(gtp_predictor_type type, const gtp_parameters* parameters,
+                                            void* storage, size_t size);
+
+/* end the life of a predictor; the storage can then be reused */
+GTP_API void gtp_predictor_destroy(gtp_predictor* predictor);
+
+/* change the parameters (takes effect with the next sample); returns 0 if one is out of range */
+GTP_API int gtp_predictor_set_parameters(gtp_predictor* predictor, const gtp_parameters* parameters);
+
+/* forget all past samples */
+GTP_API void gtp_predictor_reset(gtp_predictor* predictor);
+
+/* feed the next sample */
+GTP_API void gtp_predictor_push_sample(gtp_predictor* predictor, const gtp_sample* sample);
+
+/* position and velocity expected horizon [s] after the latest sample */
+GTP_API void gtp_predictor_predict(const gtp_predictor* predictor, double horizon, gtp_prediction* prediction);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+#endif
+/*----------------------------------------------------------------------------*/
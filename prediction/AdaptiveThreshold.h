@@ -0,0 +1,118 @@
+//==============================================================================
+/*
+    AdaptiveThreshold.h
+
+    Jitter and stop thresholds that follow an online estimate of the velocity
+    noise instead of fixed constants.
+
+    Each axis keeps an exponentially weighted mean and variance (West's
+    incremental form of Welford's algorithm) of the tick-to-tick velocity
+    change. A change is rejected as jitter when it deviates from the mean by
+    more than a multiple of the standard deviation; rejected changes are
+    clipped before they enter the estimate so spikes do not inflate it. The
+    stop threshold is a multiple of the expected L1 velocity magnitude of
+    pure noise with that standard deviation.
+
+    All updates are a handful of multiply-adds per axis; square roots are
+    only taken when a threshold is queried or a spike is clipped.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef AdaptiveThresholdH
+#define AdaptiveThresholdH
+//------------------------------------------------------------------------------
+#include <cmath>
+//------------------------------------------------------------------------------
+
+class AdaptiveJitterThreshold
+{
+public:
+
+    // a_jitterMultiple:  jitter threshold in standard deviations of the velocity change
+    // a_stopMultiple:    stop threshold in multiples of the expected noise speed
+    // a_windowSamples:   time constant of the estimates [samples]
+    // a_initialJitter:   jitter threshold [m/s] used before any sample is seen
+    AdaptiveJitterThreshold(double a_jitterMultiple = 4.0,
+                            double a_stopMultiple = 2.0,
+                            double a_windowSamples = 256.0,
+                            double a_initialJitter = 0.009)
+    {
+        m_jitterMultiple = a_jitterMultiple;
+        m_stopMultiple = a_stopMultiple;
+        m_alpha = 1.0 / a_windowSamples;
+        m_initialJitter = a_initialJitter;
+        m_minJitter = 1e-4;
+        m_minStop = 1e-5;
+        reset();
+    }
+
+    // forget the estimates and start again from the initial jitter threshold
+    void reset()
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            m_mean[i] = 0.0;
+            m_variance[i] = (m_initialJitter * m_initialJitter) / (m_jitterMultiple * m_jitterMultiple);
+        }
+    }
+
+    // classify the velocity change [m/s] of one axis and update its estimate
+    bool isJitter(int a_axis, double a_change)
+    {
+        double deviation = a_change - m_mean[a_axis];
+        double limit2 = m_jitterMultiple * m_jitterMultiple * m_variance[a_axis] + m_minJitter * m_minJitter;
+        bool jitter = (deviation * deviation >= limit2);
+
+        // clip spikes so they only widen the estimate gradually
+        if (jitter)
+        {
+            double limit = sqrt(limit2);
+            deviation = (deviation > 0.0) ? limit : -limit;
+        }
+
+        double increment = m_alpha * deviation;
+        m_mean[a_axis] += increment;
+        m_variance[a_axis] = (1.0 - m_alpha) * (m_variance[a_axis] + deviation * increment);
+
+        return jitter;
+    }
+
+    // classify a velocity L1 magnitude [m/s] as "at rest"
+    bool isStopped(double a_speed) const
+    {
+        return (a_speed < getStopThreshold());
+    }
+
+    // current jitter threshold [m/s] of one axis
+    double getJitterThreshold(int a_axis) const
+    {
+        return sqrt(m_jitterMultiple * m_jitterMultiple * m_variance[a_axis] + m_minJitter * m_minJitter);
+    }
+
+    // current stop threshold [m/s]
+    double getStopThreshold() const
+    {
+        // white velocity noise of change deviation s has a mean magnitude of s / sqrt(pi) per axis
+        const double invSqrtPi = 0.56418958354775628;
+        double sigma = sqrt(m_variance[0]) + sqrt(m_variance[1]) + sqrt(m_variance[2]);
+        double threshold = m_stopMultiple * invSqrtPi * sigma;
+        return (threshold > m_minStop) ? threshold : m_minStop;
+    }
+
+private:
+
+    double m_jitterMultiple;
+    double m_stopMultiple;
+    double m_alpha;
+    double m_initialJitter;
+    double m_minJitter;
+    double m_minStop;
+
+    double m_mean[3];
+    double m_variance[3];
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
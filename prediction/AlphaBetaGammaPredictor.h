@@ -0,0 +1,224 @@
+//==============================================================================
+/*
+    AlphaBetaGammaPredictor.h
+
+    Alpha-beta-gamma tracker over the position: a fixed-gain filter that
+    estimates position, velocity and acceleration from the positions
+    alone, a cheap steady-state form of a constant-acceleration Kalman
+    filter. Every sample is first predicted from the state, and the
+    residual r corrects each estimate with its own gain:
+
+        position     += alpha r
+        velocity     += beta / T r
+        acceleration += 2 gamma / T^2 r
+
+    The gains are those of a fading-memory (critically damped) filter with
+    discount theta = exp(-T / memory):
+
+        alpha = 1 - theta^3
+        beta  = 3/2 (1 - theta)^2 (1 + theta)
+        gamma = 1/2 (1 - theta)^3
+
+    so a single memory time sets the trade-off between measurement noise
+    in the estimates (long memory) and lag behind changes of acceleration
+    (short memory); a constant acceleration is tracked without lag. The
+    gains are recomputed only when the sample period changes.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef AlphaBetaGammaPredictorH
+#define AlphaBetaGammaPredictorH
+//------------------------------------------------------------------------------
+#include "Predictors.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// default fading memory of the tracker [s]
+const double DEFAULT_TRACKER_MEMORY = .05;
+
+//------------------------------------------------------------------------------
+
+class AlphaBetaGammaPredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    AlphaBetaGammaPredictor()
+    {
+        m_memory = DEFAULT_TRACKER_MEMORY;
+        m_gainPeriod = 0.0;
+        m_alpha = m_beta = m_gamma = 0.0;
+        m_betaRate = m_gammaRate = 0.0;
+        AlphaBetaGammaPredictor::reset();
+    }
+
+    virtual const char* getName() const { return "alpha-beta-gamma"; }
+
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        m_trackedVelocity.fill(0);
+        m_trackedAcceleration.fill(0);
+        m_time = 0.0;
+        m_started = false;
+
+        // gains follow the period of the new samples, not the ones before the reset
+        m_gainPeriod = 0.0;
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        Lanes measured;
+        measured.load(a_sample.m_position);
+
+        double period = a_sample.m_time - m_time;
+        if (!m_started || period <= 0.0)
+        {
+            // first sample (or a repeated time stamp): take the position as it is
+            if (!m_started) { m_position = measured; }
+            m_time = a_sample.m_time;
+            m_started = true;
+            return;
+        }
+        m_time = a_sample.m_time;
+
+        // gains depend on the sample period only
+        if (std::abs(period - m_gainPeriod) > 0.05 * m_gainPeriod) { setGains(period); }
+
+        PredictionScalar t = (PredictionScalar)period;
+        PredictionScalar halfT2 = (PredictionScalar)0.5 * t * t;
+        PredictionScalar alpha = (PredictionScalar)m_alpha;
+        PredictionScalar beta = (PredictionScalar)m_betaRate;
+        PredictionScalar gamma = (PredictionScalar)m_gammaRate;
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            PredictionScalar p = m_position.m_value[i];
+            PredictionScalar v = m_trackedVelocity.m_value[i];
+            PredictionScalar a = m_trackedAcceleration.m_value[i];
+
+            PredictionScalar predicted = p + t * v + halfT2 * a;
+            PredictionScalar residual = measured.m_value[i] - predicted;
+
+            m_position.m_value[i] = predicted + alpha * residual;
+            m_trackedVelocity.m_value[i] = v + t * a + beta * residual;
+            m_trackedAcceleration.m_value[i] = a + gamma * residual;
+        }
+
+        m_velocity = m_trackedVelocity;
+        clampVelocity(m_velocity);
+        m_stopped = ((double)l1NormLanes(m_velocity) < m_stopThreshold);
+    }
+
+    // tracked position, advanced along the mean velocity over the horizon (clamped like
+    // the velocity of the other predictors)
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        m_position.store(a_prediction.m_position);
+        if (m_stopped)
+        {
+            a_prediction.m_velocity[0] = a_prediction.m_velocity[1] = a_prediction.m_velocity[2] = 0.0;
+            return;
+        }
+
+        PredictionScalar h = (PredictionScalar)a_horizon;
+        Lanes mean, end, predicted;
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            mean.m_value[i] = m_trackedVelocity.m_value[i] + (PredictionScalar)0.5 * h * m_trackedAcceleration.m_value[i];
+            end.m_value[i] = m_trackedVelocity.m_value[i] + h * m_trackedAcceleration.m_value[i];
+        }
+        clampLanes(mean, m_velocityLimit);
+        clampLanes(end, m_velocityLimit);
+
+        extrapolateLanes(m_position, mean, h, predicted);
+        predicted.store(a_prediction.m_position);
+        end.store(a_prediction.m_velocity);
+    }
+
+    // fading memory [s]: longer is smoother, shorter follows changes of acceleration sooner
+    void setMemory(double a_memory)
+    {
+        m_memory = a_memory;
+        m_gainPeriod = 0.0;
+    }
+
+    double getMemory() const { return m_memory; }
+
+    // gains at the current sample period (0 before the second sample)
+    double getAlpha() const { return m_alpha; }
+    double getBeta() const { return m_beta; }
+    double getGamma() const { return m_gamma; }
+
+    // steady-state standard deviation of the position [m per m] and velocity [m/s per m]
+    // estimates for white measurement noise of unit deviation, at the current gains
+    void getNoiseRatios(double& a_position, double& a_velocity) const
+    {
+        // error covariance P = A P A' + K K' of the tracker, A = (I - K H) F
+        double t = m_gainPeriod;
+        double k[3] = { m_alpha, m_betaRate, m_gammaRate };
+        double f[3][3] = { { 1.0, t, 0.5 * t * t }, { 0.0, 1.0, t }, { 0.0, 0.0, 1.0 } };
+        double a[3][3];
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++) { a[r][c] = f[r][c] - k[r] * f[0][c]; }
+        }
+
+        double p[3][3] = { { 0 } };
+        for (int n = 0; n < 100000; n++)
+        {
+            double ap[3][3], next[3][3];
+            for (int r = 0; r < 3; r++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    ap[r][c] = a[r][0] * p[0][c] + a[r][1] * p[1][c] + a[r][2] * p[2][c];
+                }
+            }
+            double change = 0.0;
+            for (int r = 0; r < 3; r++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    next[r][c] = ap[r][0] * a[c][0] + ap[r][1] * a[c][1] + ap[r][2] * a[c][2] + k[r] * k[c];
+                    change += std::abs(next[r][c] - p[r][c]);
+                    p[r][c] = next[r][c];
+                }
+            }
+            if (change < 1e-12 * (std::abs(p[0][0]) + std::abs(p[1][1]))) { break; }
+        }
+
+        a_position = std::sqrt(p[0][0]);
+        a_velocity = std::sqrt(p[1][1]);
+    }
+
+private:
+
+    void setGains(double a_period)
+    {
+        double theta = std::exp(-a_period / m_memory);
+        double d = 1.0 - theta;
+        m_alpha = 1.0 - theta * theta * theta;
+        m_beta = 1.5 * d * d * (1.0 + theta);
+        m_gamma = 0.5 * d * d * d;
+        m_betaRate = m_beta / a_period;
+        m_gammaRate = 2.0 * m_gamma / (a_period * a_period);
+        m_gainPeriod = a_period;
+    }
+
+    Lanes m_trackedVelocity;
+    Lanes m_trackedAcceleration;
+    double m_time;
+    bool m_started;
+
+    double m_memory;
+    double m_gainPeriod;
+    double m_alpha;
+    double m_beta;
+    double m_gamma;
+    double m_betaRate;          // beta / T
+    double m_gammaRate;         // 2 gamma / T^2
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
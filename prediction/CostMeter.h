@@ -0,0 +1,61 @@
+//==============================================================================
+/*
+    CostMeter.h
+
+    Running average and maximum of the wall-clock cost of a piece of work.
+
+    Written by the thread doing the work, read by any other thread (HUD,
+    metrics) without locks. The average is exponentially weighted so it
+    follows the current load; the maximum holds until reset.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CostMeterH
+#define CostMeterH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+//------------------------------------------------------------------------------
+
+class CostMeter
+{
+public:
+
+    // a_weight: weight of a new measurement in the average
+    CostMeter(double a_weight = 0.01) : m_weight(a_weight) { reset(); }
+
+    void reset()
+    {
+        m_average.store(0.0);
+        m_max.store(0.0);
+    }
+
+    // current time [s] to pass to add()
+    static double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // fold in the cost [s] of one run (working thread)
+    void add(double a_cost)
+    {
+        double average = m_average.load(std::memory_order_relaxed);
+        m_average.store(average + m_weight * (a_cost - average), std::memory_order_relaxed);
+        if (a_cost > m_max.load(std::memory_order_relaxed)) { m_max.store(a_cost, std::memory_order_relaxed); }
+    }
+
+    // average and maximum cost [s] (any thread)
+    double getAverage() const { return m_average.load(std::memory_order_relaxed); }
+    double getMax() const { return m_max.load(std::memory_order_relaxed); }
+
+private:
+
+    double m_weight;
+    std::atomic<double> m_average;
+    std::atomic<double> m_max;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,97 @@
+//==============================================================================
+/*
+    DeadlineWatchdog.h
+
+    Per-tick budget monitor of the haptic loop with graceful degradation.
+
+    The duration of every tick is compared with its budget. An overrun
+    raises the degradation level by one, up to MAX_LEVEL; the loop sheds more
+    optional work at each level. After RECOVERY_TICKS consecutive ticks
+    within budget the level drops by one again, so work comes back one step
+    at a time once latency has recovered. Every level increase is counted
+    as a degradation event.
+
+    Written by the haptic thread only; counters can be read from any thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef DeadlineWatchdogH
+#define DeadlineWatchdogH
+//------------------------------------------------------------------------------
+#include <atomic>
+//------------------------------------------------------------------------------
+
+class DeadlineWatchdog
+{
+public:
+
+    // highest degradation level
+    static const int MAX_LEVEL = 2;
+
+    // a_budget:        tick budget [s]
+    // a_recoveryTicks: ticks within budget before the level drops by one
+    DeadlineWatchdog(double a_budget, int a_recoveryTicks = 1000)
+    {
+        m_budget = a_budget;
+        m_recoveryTicks = a_recoveryTicks;
+        m_calmTicks = 0;
+        m_level.store(0);
+        m_overruns.store(0);
+        for (int n = 0; n <= MAX_LEVEL; n++)
+        {
+            m_events[n].store(0);
+        }
+    }
+
+    // report the duration [s] of the tick that just finished (haptic thread)
+    void endTick(double a_duration)
+    {
+        int level = m_level.load(std::memory_order_relaxed);
+
+        if (a_duration > m_budget)
+        {
+            m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            m_calmTicks = 0;
+            if (level < MAX_LEVEL)
+            {
+                level++;
+                m_events[level].store(m_events[level].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                m_level.store(level, std::memory_order_relaxed);
+            }
+        }
+        else if (level > 0 && ++m_calmTicks >= m_recoveryTicks)
+        {
+            m_calmTicks = 0;
+            m_level.store(level - 1, std::memory_order_relaxed);
+        }
+    }
+
+    // current degradation level, 0 = all work enabled (any thread)
+    int getLevel() const { return m_level.load(std::memory_order_relaxed); }
+
+    // true if work that is shed at a_level must be skipped (haptic thread)
+    bool isShed(int a_level) const { return (getLevel() >= a_level); }
+
+    double getBudget() const { return m_budget; }
+
+    // ticks over budget (any thread)
+    unsigned long long getOverruns() const { return m_overruns.load(std::memory_order_relaxed); }
+
+    // number of times a_level was entered (any thread)
+    unsigned long long getEvents(int a_level) const { return m_events[a_level].load(std::memory_order_relaxed); }
+
+private:
+
+    double m_budget;
+    int m_recoveryTicks;
+    int m_calmTicks;
+
+    std::atomic<int> m_level;
+    std::atomic<unsigned long long> m_overruns;
+    std::atomic<unsigned long long> m_events[MAX_LEVEL + 1];
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
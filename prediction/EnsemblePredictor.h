@@ -0,0 +1,240 @@
+//==============================================================================
+/*
+    EnsemblePredictor.h
+
+    Runs several predictors side by side on every sample and outputs either
+    the member with the lowest recent error or an error-weighted blend.
+
+    Each tick every member is updated and asked for its prediction at the
+    scoring horizon. These predictions are queued; once the sample at their
+    target time arrives, the squared position error updates an
+    exponentially decaying score per member. The wall-clock cost of a whole
+    ensemble tick, the update and the prediction formed after it, is
+    measured so it can be checked against the haptic budget. The mode can
+    be changed from any thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef EnsemblePredictorH
+#define EnsemblePredictorH
+//------------------------------------------------------------------------------
+#include "CostMeter.h"
+#include "MotionPredictor.h"
+#include <atomic>
+//------------------------------------------------------------------------------
+
+class EnsemblePredictor : public MotionPredictor
+{
+public:
+
+    // maximum number of members
+    static const int MAX_MEMBERS = 8;
+
+    // capacity of the queue of predictions awaiting their target time
+    static const int CAPACITY = 2048;
+
+    // how the output is formed from the members
+    enum Mode
+    {
+        ENSEMBLE_SELECT_BEST,
+        ENSEMBLE_BLEND
+    };
+
+    // a_scoreHorizon: horizon [s] at which members are scored
+    // a_decay:        weight of the previous score when a new error is folded in
+    EnsemblePredictor(double a_scoreHorizon = 1.0, double a_decay = 0.995)
+    {
+        m_numMembers = 0;
+        m_mode.store(ENSEMBLE_SELECT_BEST);
+        m_pendingCost = 0.0;
+        m_scoreHorizon = a_scoreHorizon;
+        m_decay = a_decay;
+        m_best.store(0);
+        EnsemblePredictor::reset();
+    }
+
+    virtual const char* getName() const { return "ensemble"; }
+
+    // add a predictor (not owned, must outlive the ensemble); returns false if full
+    bool addMember(MotionPredictor* a_predictor)
+    {
+        if (m_numMembers == MAX_MEMBERS) { return false; }
+        m_members[m_numMembers++] = a_predictor;
+        return true;
+    }
+
+    int getNumMembers() const { return m_numMembers; }
+    MotionPredictor* getMember(int a_index) const { return m_members[a_index]; }
+
+    // horizon [s] at which members are scored, from the next update on (predictions
+    // already queued keep their target times)
+    void setScoreHorizon(double a_scoreHorizon) { m_scoreHorizon = a_scoreHorizon; }
+    double getScoreHorizon() const { return m_scoreHorizon; }
+
+    // output mode (any thread; applies from the next prediction)
+    void setMode(Mode a_mode) { m_mode.store(a_mode, std::memory_order_relaxed); }
+    Mode getMode() const { return (Mode)m_mode.load(std::memory_order_relaxed); }
+
+    virtual void reset()
+    {
+        for (int m = 0; m < m_numMembers; m++)
+        {
+            m_members[m]->reset();
+        }
+        for (int m = 0; m < MAX_MEMBERS; m++)
+        {
+            m_score[m] = 0.0;
+            m_scored[m] = false;
+        }
+        m_head = 0;
+        m_tail = 0;
+        m_latestHorizon = -1.0;
+        m_best.store(0);
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        double start = CostMeter::now();
+
+        // an update nobody predicted from counts on its own
+        if (m_pendingCost > 0.0) { m_cost.add(m_pendingCost); }
+
+        // score matured predictions against the new sample
+        while (m_tail != m_head)
+        {
+            Entry& entry = m_queue[m_tail % CAPACITY];
+            if (entry.m_time > a_sample.m_time) { break; }
+
+            for (int m = 0; m < m_numMembers; m++)
+            {
+                double error2 = 0.0;
+                for (int i = 0; i < 3; i++)
+                {
+                    double error = a_sample.m_position[i] - entry.m_position[m][i];
+                    error2 += error * error;
+                }
+                m_score[m] = m_scored[m] ? m_decay * m_score[m] + (1.0 - m_decay) * error2 : error2;
+                m_scored[m] = true;
+            }
+            m_tail++;
+        }
+
+        // run every member and queue its prediction at the scoring horizon
+        if (m_head - m_tail == CAPACITY) { m_tail++; }
+        Entry& entry = m_queue[m_head % CAPACITY];
+        entry.m_time = a_sample.m_time + m_scoreHorizon;
+        m_latestHorizon = m_scoreHorizon;
+
+        for (int m = 0; m < m_numMembers; m++)
+        {
+            m_members[m]->update(a_sample);
+            m_members[m]->predict(m_scoreHorizon, m_latest[m]);
+            for (int i = 0; i < 3; i++)
+            {
+                entry.m_position[m][i] = m_latest[m].m_position[i];
+            }
+        }
+        m_head++;
+
+        // lowest score wins
+        int best = 0;
+        for (int m = 1; m < m_numMembers; m++)
+        {
+            if (m_score[m] < m_score[best]) { best = m; }
+        }
+        m_best.store(best, std::memory_order_relaxed);
+
+        // completed by the prediction that follows
+        m_pendingCost = CostMeter::now() - start;
+    }
+
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        double start = CostMeter::now();
+        combine(a_horizon, a_prediction);
+        m_cost.add(m_pendingCost + CostMeter::now() - start);
+        m_pendingCost = 0.0;
+    }
+
+    // decaying mean squared error [m^2] of a member
+    double getScore(int a_member) const { return m_score[a_member]; }
+
+    // member with the lowest score (any thread)
+    int getBest() const { return m_best.load(std::memory_order_relaxed); }
+
+    // average and maximum wall-clock cost [s] of one update and the prediction after
+    // it (any thread)
+    double getCostAverage() const { return m_cost.getAverage(); }
+    double getCostMax() const { return m_cost.getMax(); }
+
+private:
+
+    struct Entry
+    {
+        double m_time;
+        double m_position[MAX_MEMBERS][3];
+    };
+
+    // best member or blend of the members at a_horizon
+    void combine(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        if (m_numMembers == 0) { return; }
+
+        // reuse the predictions made during update when the horizon matches
+        MotionPrediction member[MAX_MEMBERS];
+        for (int m = 0; m < m_numMembers; m++)
+        {
+            if (a_horizon == m_latestHorizon) { member[m] = m_latest[m]; }
+            else { m_members[m]->predict(a_horizon, member[m]); }
+        }
+
+        if (m_mode.load(std::memory_order_relaxed) == ENSEMBLE_SELECT_BEST)
+        {
+            a_prediction = member[m_best.load(std::memory_order_relaxed)];
+            return;
+        }
+
+        // blend with weights inversely proportional to the score
+        double weight[MAX_MEMBERS];
+        double total = 0.0;
+        for (int m = 0; m < m_numMembers; m++)
+        {
+            weight[m] = 1.0 / (m_score[m] + 1e-12);
+            total += weight[m];
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            a_prediction.m_position[i] = 0.0;
+            a_prediction.m_velocity[i] = 0.0;
+            for (int m = 0; m < m_numMembers; m++)
+            {
+                a_prediction.m_position[i] += (weight[m] / total) * member[m].m_position[i];
+                a_prediction.m_velocity[i] += (weight[m] / total) * member[m].m_velocity[i];
+            }
+        }
+    }
+
+    int m_numMembers;
+    MotionPredictor* m_members[MAX_MEMBERS];
+    MotionPrediction m_latest[MAX_MEMBERS];
+    double m_latestHorizon;                 // horizon of m_latest, -1 before the first update
+
+    std::atomic<int> m_mode;
+    double m_scoreHorizon;
+    double m_decay;
+    double m_score[MAX_MEMBERS];
+    bool m_scored[MAX_MEMBERS];
+
+    Entry m_queue[CAPACITY];
+    unsigned long long m_head;
+    unsigned long long m_tail;
+
+    std::atomic<int> m_best;
+    mutable CostMeter m_cost;
+    mutable double m_pendingCost;           // cost of the last update not yet counted
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
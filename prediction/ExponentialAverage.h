@@ -0,0 +1,141 @@
+//==============================================================================
+/*
+    ExponentialAverage.h
+
+    Exponential moving average on every lane:
+
+        average += alpha * (sample - average)
+
+    one multiply-add per lane with a constant smoothing factor, instead of
+    the running average's division by a weight that changes every sample.
+    alpha follows from a time constant tau and the sample period T,
+
+        alpha = 1 - exp(-T / tau)
+
+    and can be computed at compile time (emaAlpha is constexpr) or when a
+    parameter file is loaded. For the chosen alpha the average lags a ramp
+    by (1 - alpha) / alpha samples and passes sqrt(alpha / (2 - alpha)) of
+    the standard deviation of white noise.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef ExponentialAverageH
+#define ExponentialAverageH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// default time constant of the average [s] (about the lag of the 31-sample running
+// average at 1 kHz)
+constexpr double DEFAULT_EMA_TIME_CONSTANT = .015;
+
+
+//------------------------------------------------------------------------------
+// COEFFICIENTS
+//------------------------------------------------------------------------------
+
+// Taylor series of e^x from term n on (term = x^n / n!), 24 terms
+inline constexpr double emaExpSeries(double x, int n, double term)
+{
+    return (n > 24) ? 0.0 : term + emaExpSeries(x, n + 1, term * x / (n + 1));
+}
+
+inline constexpr double emaSquare(double v)
+{
+    return v * v;
+}
+
+// e^x, halving x until the series converges quickly
+inline constexpr double emaExp(double x)
+{
+    return (x > 1.0 || x < -1.0) ? emaSquare(emaExp(0.5 * x)) : emaExpSeries(x, 0, 1.0);
+}
+
+// smoothing factor for time constant a_timeConstant [s] at sample period a_period [s]
+inline constexpr double emaAlpha(double a_timeConstant, double a_period)
+{
+    return 1.0 - emaExp(-a_period / a_timeConstant);
+}
+
+// lag of the average behind a ramp [samples]
+inline constexpr double emaLagSamples(double a_alpha)
+{
+    return (1.0 - a_alpha) / a_alpha;
+}
+
+// fraction of the variance of white noise that passes the average
+inline constexpr double emaNoiseVarianceRatio(double a_alpha)
+{
+    return a_alpha / (2.0 - a_alpha);
+}
+
+// alpha = 1 - 1/e when the time constant is one sample
+static_assert(emaAlpha(1.0, 1.0) - 0.6321205588285577 < 1e-15 && emaAlpha(1.0, 1.0) - 0.6321205588285577 > -1e-15,
+              "unexpected exponential average coefficient");
+
+
+//------------------------------------------------------------------------------
+// AVERAGE
+//------------------------------------------------------------------------------
+
+template <typename T, int LANES>
+class ExponentialAverage
+{
+public:
+
+    typedef LaneVector<T, LANES> Vector;
+
+    // a_alpha: smoothing factor in (0, 1], 1 passes the samples through
+    ExponentialAverage(double a_alpha = 1.0)
+    {
+        setAlpha(a_alpha);
+        reset();
+    }
+
+    void setAlpha(double a_alpha) { m_alpha = a_alpha; }
+
+    // smoothing factor for a time constant [s] at a sample rate [Hz]
+    void setTimeConstant(double a_timeConstant, double a_rate)
+    {
+        setAlpha(1.0 - std::exp(-1.0 / (a_timeConstant * a_rate)));
+    }
+
+    double getAlpha() const { return m_alpha; }
+
+    // lag behind a ramp [samples] and standard deviation of white noise passed [0..1]
+    double getLagSamples() const { return emaLagSamples(m_alpha); }
+    double getNoiseRatio() const { return std::sqrt(emaNoiseVarianceRatio(m_alpha)); }
+
+    // forget the average; the next sample starts it
+    void reset() { m_empty = true; }
+
+    // replace a sample with the updated average
+    void filter(Vector& a_value)
+    {
+        if (m_empty)
+        {
+            m_value = a_value;
+            m_empty = false;
+            return;
+        }
+
+        T alpha = (T)m_alpha;
+        for (int i = 0; i < LANES; i++)
+        {
+            m_value.m_value[i] += alpha * (a_value.m_value[i] - m_value.m_value[i]);
+        }
+        a_value = m_value;
+    }
+
+private:
+
+    Vector m_value;
+    bool m_empty;
+    double m_alpha;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,141 @@
+//==============================================================================
+/*
+    FileWatcher.h
+
+    Background thread calling a function whenever a file is written.
+
+    On Linux the directory of the file is watched with inotify, which also
+    catches editors that save by writing a new file and renaming it over
+    the old one. Elsewhere the modification time and size of the file are
+    polled twice a second. The function runs on the watcher thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef FileWatcherH
+#define FileWatcherH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+//------------------------------------------------------------------------------
+
+class FileWatcher
+{
+public:
+
+    FileWatcher() { m_running.store(false); }
+
+    ~FileWatcher() { stop(); }
+
+    // call a_changed after every write to a_filename (the file may not exist yet)
+    void start(const std::string& a_filename, std::function<void()> a_changed)
+    {
+        stop();
+
+        m_filename = a_filename;
+        m_changed = a_changed;
+        m_running.store(true);
+        m_thread = std::thread(&FileWatcher::run, this);
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable()) { return; }
+
+        m_running.store(false);
+        m_thread.join();
+    }
+
+private:
+
+    void run()
+    {
+#ifdef __linux__
+        if (watchNotify()) { return; }
+#endif
+        watchPoll();
+    }
+
+#ifdef __linux__
+
+    // returns false if inotify is unavailable
+    bool watchNotify()
+    {
+        size_t slash = m_filename.find_last_of('/');
+        std::string directory = (slash == std::string::npos) ? "." : m_filename.substr(0, slash + 1);
+        std::string name = (slash == std::string::npos) ? m_filename : m_filename.substr(slash + 1);
+
+        int descriptor = inotify_init1(IN_NONBLOCK);
+        if (descriptor < 0) { return false; }
+        if (inotify_add_watch(descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+
+        // events are aligned to their header; names are padded accordingly
+        alignas(inotify_event) char buffer[4096];
+        while (m_running.load())
+        {
+            pollfd events = { descriptor, POLLIN, 0 };
+            if (poll(&events, 1, 200) <= 0) { continue; }
+
+            bool changed = false;
+            ssize_t length;
+            while ((length = read(descriptor, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* event = buffer; event < buffer + length; )
+                {
+                    const inotify_event* header = (const inotify_event*)event;
+                    if (header->len > 0 && name == header->name) { changed = true; }
+                    event += sizeof(inotify_event) + header->len;
+                }
+            }
+            if (changed) { m_changed(); }
+        }
+
+        ::close(descriptor);
+        return true;
+    }
+
+#endif
+
+    void watchPoll()
+    {
+        struct stat previous;
+        bool existed = (stat(m_filename.c_str(), &previous) == 0);
+
+        while (m_running.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+            struct stat current;
+            bool exists = (stat(m_filename.c_str(), &current) == 0);
+            if (exists && (!existed || current.st_mtime != previous.st_mtime || current.st_size != previous.st_size))
+            {
+                m_changed();
+            }
+            existed = exists;
+            if (exists) { previous = current; }
+        }
+    }
+
+    std::string m_filename;
+    std::function<void()> m_changed;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+//==============================================================================
+/*
+    KernelAccuracy.h
+
+    Accuracy check of a reduced precision build of the predictor kernels.
+
+    A synthetic hand trajectory sweeping the device workspace is passed
+    through the anti-aliasing filter, the Savitzky-Golay differentiator and
+    the extrapolation kernel twice: once with scalar type T and once in
+    double precision. The largest deviations are returned so they can be
+    compared with the position resolution of the device.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef KernelAccuracyH
+#define KernelAccuracyH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+#include "MultiRateScheduler.h"
+#include "SavitzkyGolay.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// nominal position resolution [m] of the Geomagic Touch
+const double TOUCH_POSITION_RESOLUTION = 0.055e-3;
+
+// largest deviations of the reduced precision kernels from the double reference
+struct KernelAccuracy
+{
+    double m_maxPositionError;      // filtered position [m]
+    double m_maxVelocityError;      // differentiated velocity [m/s]
+    double m_maxPredictionError;    // extrapolated position [m]
+};
+
+//------------------------------------------------------------------------------
+
+template <typename T, int HALF_WINDOW>
+KernelAccuracy checkKernelAccuracy(double a_sampleRate, double a_cutoff, double a_horizon, double a_duration = 10.0)
+{
+    typedef LaneVector<T, LANES_PER_DEVICE> Lanes;
+    typedef LaneVector<double, LANES_PER_DEVICE> ReferenceLanes;
+
+    LowPassBiquad<T> filter;
+    LowPassBiquad<double> referenceFilter;
+    filter.design(a_sampleRate, a_cutoff);
+    referenceFilter.design(a_sampleRate, a_cutoff);
+
+    SavitzkyGolayDifferentiator<HALF_WINDOW, T> differentiator;
+    SavitzkyGolayDifferentiator<HALF_WINDOW, double> referenceDifferentiator;
+
+    KernelAccuracy accuracy = { 0.0, 0.0, 0.0 };
+    const double pi = 3.14159265358979323846;
+    int samples = (int)(a_duration * a_sampleRate);
+
+    for (int n = 0; n < samples; n++)
+    {
+        // slow sweeps with a faster tremor component, offset from the workspace centre
+        double t = n / a_sampleRate;
+        double position[3] =
+        {
+            0.02 + 0.06 * sin(2.0 * pi * 0.7 * t) + 0.001 * sin(2.0 * pi * 9.0 * t),
+           -0.01 + 0.08 * sin(2.0 * pi * 0.3 * t + 1.0),
+            0.03 + 0.05 * cos(2.0 * pi * 1.1 * t)
+        };
+
+        Lanes input, filtered, velocity, predicted;
+        ReferenceLanes referenceInput, referenceFiltered, referenceVelocity, referencePredicted;
+        input.load(position);
+        referenceInput.load(position);
+
+        filter.filter(input, filtered);
+        referenceFilter.filter(referenceInput, referenceFiltered);
+
+        differentiator.push(t, filtered);
+        referenceDifferentiator.push(t, referenceFiltered);
+        if (!differentiator.isReady()) { continue; }
+
+        differentiator.getLatestVelocity(velocity);
+        referenceDifferentiator.getLatestVelocity(referenceVelocity);
+
+        extrapolateLanes(filtered, velocity, (T)a_horizon, predicted);
+        extrapolateLanes(referenceFiltered, referenceVelocity, a_horizon, referencePredicted);
+
+        for (int i = 0; i < 3; i++)
+        {
+            double positionError = fabs((double)filtered.m_value[i] - referenceFiltered.m_value[i]);
+            double velocityError = fabs((double)velocity.m_value[i] - referenceVelocity.m_value[i]);
+            double predictionError = fabs((double)predicted.m_value[i] - referencePredicted.m_value[i]);
+            if (positionError > accuracy.m_maxPositionError) { accuracy.m_maxPositionError = positionError; }
+            if (velocityError > accuracy.m_maxVelocityError) { accuracy.m_maxVelocityError = velocityError; }
+            if (predictionError > accuracy.m_maxPredictionError) { accuracy.m_maxPredictionError = predictionError; }
+        }
+    }
+
+    return accuracy;
+}
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,198 @@
+//==============================================================================
+/*
+    LaneKernels.h
+
+    Element-wise kernels used by the predictors, templated on the scalar
+    type and on the number of lanes processed together.
+
+    A device occupies four lanes (x, y, z and a padding lane), so one
+    LaneVector<float, 4> fills an SSE/NEON register and a
+    LaneVector<double, 4> an AVX register. The kernels are written as
+    fixed-length loops without branches on the data so the compiler turns
+    them into single vector instructions.
+
+    Define PREDICTION_FLOAT32 to build the predictors in single precision;
+    the default is double precision.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef LaneKernelsH
+#define LaneKernelsH
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// SETTINGS
+//------------------------------------------------------------------------------
+
+#ifdef PREDICTION_FLOAT32
+typedef float PredictionScalar;
+#else
+typedef double PredictionScalar;
+#endif
+
+// lanes occupied by one device (x, y, z, padding)
+const int LANES_PER_DEVICE = 4;
+
+
+//------------------------------------------------------------------------------
+// LANE VECTOR
+//------------------------------------------------------------------------------
+
+template <typename T, int LANES>
+struct alignas(sizeof(T) * LANES) LaneVector
+{
+    T m_value[LANES];
+
+    // set all lanes to the same value
+    void fill(T a_value)
+    {
+        for (int i = 0; i < LANES; i++) { m_value[i] = a_value; }
+    }
+
+    // load x/y/z of device a_device (padding lane cleared)
+    void load(const double a_xyz[3], int a_device = 0)
+    {
+        T* lanes = &m_value[a_device * LANES_PER_DEVICE];
+        lanes[0] = (T)a_xyz[0];
+        lanes[1] = (T)a_xyz[1];
+        lanes[2] = (T)a_xyz[2];
+        lanes[3] = (T)0;
+    }
+
+    // store x/y/z of device a_device
+    void store(double a_xyz[3], int a_device = 0) const
+    {
+        const T* lanes = &m_value[a_device * LANES_PER_DEVICE];
+        a_xyz[0] = (double)lanes[0];
+        a_xyz[1] = (double)lanes[1];
+        a_xyz[2] = (double)lanes[2];
+    }
+};
+
+
+// heap memory for objects holding lane vectors (before C++17, operator new only
+// guarantees the alignment of the largest scalar type)
+inline void* allocateAligned(size_t a_size, size_t a_alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(a_size, a_alignment);
+#else
+    void* memory = NULL;
+    if (posix_memalign(&memory, a_alignment, a_size) != 0) { return NULL; }
+    return memory;
+#endif
+}
+
+inline void freeAligned(void* a_memory)
+{
+#ifdef _WIN32
+    _aligned_free(a_memory);
+#else
+    free(a_memory);
+#endif
+}
+
+
+//------------------------------------------------------------------------------
+// KERNELS
+//------------------------------------------------------------------------------
+
+// a_value = min(max(a_value, -a_limit), a_limit)
+template <typename T, int LANES>
+inline void clampLanes(LaneVector<T, LANES>& a_value, const LaneVector<T, LANES>& a_limit)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        T v = a_value.m_value[i];
+        T l = a_limit.m_value[i];
+        v = (v > l) ? l : v;
+        v = (v < -l) ? -l : v;
+        a_value.m_value[i] = v;
+    }
+}
+
+// a_mask = |a_current - a_previous| >= a_threshold, as 1 or 0 per lane
+template <typename T, int LANES>
+inline void jitterMaskLanes(const LaneVector<T, LANES>& a_current,
+                            const LaneVector<T, LANES>& a_previous,
+                            const LaneVector<T, LANES>& a_threshold,
+                            LaneVector<T, LANES>& a_mask)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        T change = a_current.m_value[i] - a_previous.m_value[i];
+        change = (change < 0) ? -change : change;
+        a_mask.m_value[i] = (change >= a_threshold.m_value[i]) ? (T)1 : (T)0;
+    }
+}
+
+// extend a lane mask to all lanes of the same device (any axis set -> whole device set)
+template <typename T, int LANES>
+inline void spreadMaskLanes(LaneVector<T, LANES>& a_mask)
+{
+    for (int d = 0; d < LANES; d += LANES_PER_DEVICE)
+    {
+        T* m = &a_mask.m_value[d];
+        T any = (m[0] + m[1] + m[2] > (T)0) ? (T)1 : (T)0;
+        m[0] = m[1] = m[2] = m[3] = any;
+    }
+}
+
+// a_result = a_mask ? a_ifSet : a_ifClear
+template <typename T, int LANES>
+inline void selectLanes(const LaneVector<T, LANES>& a_mask,
+                        const LaneVector<T, LANES>& a_ifSet,
+                        const LaneVector<T, LANES>& a_ifClear,
+                        LaneVector<T, LANES>& a_result)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        a_result.m_value[i] = (a_mask.m_value[i] != (T)0) ? a_ifSet.m_value[i] : a_ifClear.m_value[i];
+    }
+}
+
+// sort each lane pair: a_low = min(a_low, a_high), a_high = max(a_low, a_high)
+// (compare-exchange, the building block of sorting networks)
+template <typename T, int LANES>
+inline void compareExchangeLanes(LaneVector<T, LANES>& a_low, LaneVector<T, LANES>& a_high)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        T a = a_low.m_value[i];
+        T b = a_high.m_value[i];
+        a_low.m_value[i] = (a < b) ? a : b;
+        a_high.m_value[i] = (a < b) ? b : a;
+    }
+}
+
+// a_result = a_position + a_horizon * a_velocity
+template <typename T, int LANES>
+inline void extrapolateLanes(const LaneVector<T, LANES>& a_position,
+                             const LaneVector<T, LANES>& a_velocity,
+                             T a_horizon,
+                             LaneVector<T, LANES>& a_result)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        a_result.m_value[i] = a_position.m_value[i] + a_horizon * a_velocity.m_value[i];
+    }
+}
+
+// L1 norm of the x/y/z lanes of a device
+template <typename T, int LANES>
+inline T l1NormLanes(const LaneVector<T, LANES>& a_value, int a_device = 0)
+{
+    const T* v = &a_value.m_value[a_device * LANES_PER_DEVICE];
+    return std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+}
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,270 @@
+//==============================================================================
+/*
+    LearnedModel.h
+
+    Autoregressive motion model trained offline (tools/ModelTrainer.cpp)
+    and its binary file format.
+
+    The same model is applied to each axis. Its inputs are the last ORDER
+    position differences, divided by the sample period, and the velocity
+    reported by the device, all divided by a velocity scale; its output is
+    the mean velocity over the trained horizon in the same scale:
+
+        linear  y = w . x + b
+        MLP     y = v . relu(W x + c) + b       (one hidden layer)
+
+    A model is only valid at the sample period it was trained at, which
+    the file records.
+
+    File (little-endian): "GTPMODL1", uint32 type, order, hidden units,
+    double period [s], horizon [s], velocity scale [m/s], then the float32
+    weights: hidden weights (hidden x inputs, row major) and biases (MLP
+    only), output weights (inputs or hidden units) and output bias.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef LearnedModelH
+#define LearnedModelH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+#include "TraceCodec.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+//------------------------------------------------------------------------------
+
+// model types
+const int LEARNED_LINEAR = 0;
+const int LEARNED_MLP    = 1;
+
+// largest model: position differences and hidden units
+const int LEARNED_MAX_ORDER  = 16;
+const int LEARNED_MAX_INPUTS = LEARNED_MAX_ORDER + 1;
+const int LEARNED_MAX_HIDDEN = 32;
+
+static_assert(LEARNED_MAX_HIDDEN >= LEARNED_MAX_INPUTS, "output weights must hold a linear model");
+
+// file signature
+const char LEARNED_MODEL_MAGIC[9] = "GTPMODL1";
+
+// bytes before the weights
+const int LEARNED_HEADER_BYTES = 8 + 3 * 4 + 3 * 8;
+
+//------------------------------------------------------------------------------
+
+struct LearnedModel
+{
+    LearnedModel()
+    {
+        m_type = LEARNED_LINEAR;
+        m_order = 1;
+        m_hidden = 0;
+        m_period = m_horizon = m_scale = 0.0;
+        memset(m_hiddenWeight, 0, sizeof(m_hiddenWeight));
+        memset(m_hiddenBias, 0, sizeof(m_hiddenBias));
+        memset(m_outputWeight, 0, sizeof(m_outputWeight));
+        m_outputBias = 0.0f;
+    }
+
+    int getNumInputs() const { return m_order + 1; }
+
+    // number of float weights in the file
+    int getNumWeights() const
+    {
+        int inputs = getNumInputs();
+        return (m_type == LEARNED_MLP) ? m_hidden * inputs + 2 * m_hidden + 1 : inputs + 1;
+    }
+
+    int m_type;                 // LEARNED_LINEAR or LEARNED_MLP
+    int m_order;                // position differences in the inputs (1..LEARNED_MAX_ORDER)
+    int m_hidden;               // hidden units (MLP, 1..LEARNED_MAX_HIDDEN)
+    double m_period;            // sample period [s]
+    double m_horizon;           // horizon of the output [s]
+    double m_scale;             // velocity scale of inputs and output [m/s]
+
+    float m_hiddenWeight[LEARNED_MAX_HIDDEN][LEARNED_MAX_INPUTS];
+    float m_hiddenBias[LEARNED_MAX_HIDDEN];
+    float m_outputWeight[LEARNED_MAX_HIDDEN];
+    float m_outputBias;
+};
+
+
+//------------------------------------------------------------------------------
+// INPUTS
+//------------------------------------------------------------------------------
+
+// model inputs of every lane from the stream of samples
+template <typename T, int LANES>
+class LearnedModelInputs
+{
+public:
+
+    typedef LaneVector<T, LANES> Vector;
+
+    LearnedModelInputs() { reset(); }
+
+    void reset()
+    {
+        m_count = 0;
+        m_next = 0;
+    }
+
+    void push(const Vector& a_position, const Vector& a_velocity)
+    {
+        m_position[m_next] = a_position;
+        m_velocity = a_velocity;
+        m_next = (m_next + 1) % RING;
+        m_count++;
+    }
+
+    // true once order + 1 positions have been pushed
+    bool isReady(const LearnedModel& a_model) const { return (m_count > (unsigned long long)a_model.m_order); }
+
+    // inputs of a_model, a_inputs[0..order] (the newest difference first, the velocity last)
+    void compute(const LearnedModel& a_model, Vector* a_inputs) const
+    {
+        T differenceScale = (T)(1.0 / (a_model.m_period * a_model.m_scale));
+        T velocityScale = (T)(1.0 / a_model.m_scale);
+
+        int newest = (m_next + RING - 1) % RING;
+        for (int k = 0; k < a_model.m_order; k++)
+        {
+            const Vector& later = m_position[(newest + RING - k) % RING];
+            const Vector& earlier = m_position[(newest + RING - k - 1) % RING];
+            for (int i = 0; i < LANES; i++)
+            {
+                a_inputs[k].m_value[i] = (later.m_value[i] - earlier.m_value[i]) * differenceScale;
+            }
+        }
+        for (int i = 0; i < LANES; i++)
+        {
+            a_inputs[a_model.m_order].m_value[i] = m_velocity.m_value[i] * velocityScale;
+        }
+    }
+
+private:
+
+    static const int RING = LEARNED_MAX_ORDER + 1;
+
+    Vector m_position[RING];
+    Vector m_velocity;
+    int m_next;
+    unsigned long long m_count;
+};
+
+
+//------------------------------------------------------------------------------
+// FILE
+//------------------------------------------------------------------------------
+
+// write a model, returns false if the file cannot be written
+inline bool saveLearnedModel(const char* a_filename, const LearnedModel& a_model)
+{
+    FILE* file = fopen(a_filename, "wb");
+    if (file == NULL) { return false; }
+
+    unsigned char header[LEARNED_HEADER_BYTES];
+    memcpy(header, LEARNED_MODEL_MAGIC, 8);
+    traceWriteUint32((unsigned int)a_model.m_type, header + 8);
+    traceWriteUint32((unsigned int)a_model.m_order, header + 12);
+    traceWriteUint32((unsigned int)a_model.m_hidden, header + 16);
+    traceWriteDouble(a_model.m_period, header + 20);
+    traceWriteDouble(a_model.m_horizon, header + 28);
+    traceWriteDouble(a_model.m_scale, header + 36);
+    bool written = (fwrite(header, 1, sizeof(header), file) == sizeof(header));
+
+    float weights[LEARNED_MAX_HIDDEN * LEARNED_MAX_INPUTS + 2 * LEARNED_MAX_HIDDEN + 1];
+    int count = 0;
+    int inputs = a_model.getNumInputs();
+    int outputs = (a_model.m_type == LEARNED_MLP) ? a_model.m_hidden : inputs;
+    if (a_model.m_type == LEARNED_MLP)
+    {
+        for (int j = 0; j < a_model.m_hidden; j++)
+        {
+            for (int k = 0; k < inputs; k++) { weights[count++] = a_model.m_hiddenWeight[j][k]; }
+        }
+        for (int j = 0; j < a_model.m_hidden; j++) { weights[count++] = a_model.m_hiddenBias[j]; }
+    }
+    for (int j = 0; j < outputs; j++) { weights[count++] = a_model.m_outputWeight[j]; }
+    weights[count++] = a_model.m_outputBias;
+
+    for (int n = 0; n < count && written; n++)
+    {
+        unsigned int bits;
+        unsigned char bytes[4];
+        memcpy(&bits, &weights[n], 4);
+        traceWriteUint32(bits, bytes);
+        written = (fwrite(bytes, 1, 4, file) == 4);
+    }
+
+    return (fclose(file) == 0) && written;
+}
+
+//------------------------------------------------------------------------------
+
+// read a model, returns false and a message if it is missing or invalid
+inline bool loadLearnedModel(const char* a_filename, LearnedModel& a_model, std::string& a_error)
+{
+    FILE* file = fopen(a_filename, "rb");
+    if (file == NULL)
+    {
+        a_error = std::string("cannot read ") + a_filename;
+        return false;
+    }
+
+    LearnedModel model;
+    unsigned char header[LEARNED_HEADER_BYTES];
+    bool valid = (fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, LEARNED_MODEL_MAGIC, 8) == 0);
+    if (valid)
+    {
+        model.m_type = (int)traceReadUint32(header + 8);
+        model.m_order = (int)traceReadUint32(header + 12);
+        model.m_hidden = (int)traceReadUint32(header + 16);
+        model.m_period = traceReadDouble(header + 20);
+        model.m_horizon = traceReadDouble(header + 28);
+        model.m_scale = traceReadDouble(header + 36);
+        valid = (model.m_type == LEARNED_LINEAR || model.m_type == LEARNED_MLP) &&
+                model.m_order >= 1 && model.m_order <= LEARNED_MAX_ORDER &&
+                (model.m_type == LEARNED_LINEAR || (model.m_hidden >= 1 && model.m_hidden <= LEARNED_MAX_HIDDEN)) &&
+                model.m_period > 0.0 && model.m_horizon > 0.0 && model.m_scale > 0.0;
+    }
+
+    float weights[LEARNED_MAX_HIDDEN * LEARNED_MAX_INPUTS + 2 * LEARNED_MAX_HIDDEN + 1];
+    int count = valid ? model.getNumWeights() : 0;
+    for (int n = 0; n < count && valid; n++)
+    {
+        unsigned char bytes[4];
+        valid = (fread(bytes, 1, 4, file) == 4);
+        unsigned int bits = traceReadUint32(bytes);
+        memcpy(&weights[n], &bits, 4);
+    }
+    fclose(file);
+
+    if (!valid)
+    {
+        a_error = std::string(a_filename) + " is not a valid model";
+        return false;
+    }
+
+    int inputs = model.getNumInputs();
+    int outputs = (model.m_type == LEARNED_MLP) ? model.m_hidden : inputs;
+    int next = 0;
+    if (model.m_type == LEARNED_MLP)
+    {
+        for (int j = 0; j < model.m_hidden; j++)
+        {
+            for (int k = 0; k < inputs; k++) { model.m_hiddenWeight[j][k] = weights[next++]; }
+        }
+        for (int j = 0; j < model.m_hidden; j++) { model.m_hiddenBias[j] = weights[next++]; }
+    }
+    for (int j = 0; j < outputs; j++) { model.m_outputWeight[j] = weights[next++]; }
+    model.m_outputBias = weights[next++];
+
+    a_model = model;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,131 @@
+//==============================================================================
+/*
+    LearnedPredictor.h
+
+    Predictor evaluating an offline-trained model (LearnedModel.h) on
+    every sample. The model gives the mean velocity over its horizon, which
+    is clamped and extrapolated like the velocity of the other predictors.
+
+    The weights are copied into the predictor, converted to the kernel
+    scalar type, and the three axes are evaluated together: every weight
+    is applied to a lane vector of x/y/z inputs, so each multiply-add of
+    the model is one vector instruction and nothing is allocated.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef LearnedPredictorH
+#define LearnedPredictorH
+//------------------------------------------------------------------------------
+#include "LearnedModel.h"
+#include "Predictors.h"
+//------------------------------------------------------------------------------
+
+class LearnedPredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    LearnedPredictor()
+    {
+        m_loaded = false;
+        LearnedPredictor::reset();
+    }
+
+    virtual const char* getName() const { return "learned"; }
+
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        m_inputs.reset();
+    }
+
+    // use a_model from the next sample on (not while another thread updates the predictor)
+    void setModel(const LearnedModel& a_model)
+    {
+        m_model = a_model;
+        int inputs = a_model.getNumInputs();
+        int outputs = (a_model.m_type == LEARNED_MLP) ? a_model.m_hidden : inputs;
+        for (int j = 0; j < a_model.m_hidden; j++)
+        {
+            for (int k = 0; k < inputs; k++) { m_hiddenWeight[j][k] = (PredictionScalar)a_model.m_hiddenWeight[j][k]; }
+            m_hiddenBias[j] = (PredictionScalar)a_model.m_hiddenBias[j];
+        }
+        for (int j = 0; j < outputs; j++) { m_outputWeight[j] = (PredictionScalar)a_model.m_outputWeight[j]; }
+        m_outputBias = (PredictionScalar)a_model.m_outputBias;
+        m_outputScale = (PredictionScalar)a_model.m_scale;
+        m_loaded = true;
+        reset();
+    }
+
+    bool hasModel() const { return m_loaded; }
+    const LearnedModel& getModel() const { return m_model; }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        m_position.load(a_sample.m_position);
+        Lanes velocity;
+        velocity.load(a_sample.m_velocity);
+        m_inputs.push(m_position, velocity);
+
+        if (!m_loaded || !m_inputs.isReady(m_model))
+        {
+            m_stopped = true;
+            return;
+        }
+
+        Lanes inputs[LEARNED_MAX_INPUTS];
+        m_inputs.compute(m_model, inputs);
+
+        Lanes output;
+        output.fill(m_outputBias);
+        int numInputs = m_model.getNumInputs();
+        if (m_model.m_type == LEARNED_MLP)
+        {
+            for (int j = 0; j < m_model.m_hidden; j++)
+            {
+                Lanes hidden;
+                hidden.fill(m_hiddenBias[j]);
+                for (int k = 0; k < numInputs; k++)
+                {
+                    PredictionScalar w = m_hiddenWeight[j][k];
+                    for (int i = 0; i < LANES_PER_DEVICE; i++) { hidden.m_value[i] += w * inputs[k].m_value[i]; }
+                }
+
+                PredictionScalar v = m_outputWeight[j];
+                for (int i = 0; i < LANES_PER_DEVICE; i++)
+                {
+                    PredictionScalar h = hidden.m_value[i];
+                    output.m_value[i] += v * ((h > (PredictionScalar)0) ? h : (PredictionScalar)0);
+                }
+            }
+        }
+        else
+        {
+            for (int k = 0; k < numInputs; k++)
+            {
+                PredictionScalar w = m_outputWeight[k];
+                for (int i = 0; i < LANES_PER_DEVICE; i++) { output.m_value[i] += w * inputs[k].m_value[i]; }
+            }
+        }
+
+        for (int i = 0; i < LANES_PER_DEVICE; i++) { m_velocity.m_value[i] = output.m_value[i] * m_outputScale; }
+        clampVelocity(m_velocity);
+        m_stopped = ((double)l1NormLanes(m_velocity) < m_stopThreshold);
+    }
+
+private:
+
+    LearnedModelInputs<PredictionScalar, LANES_PER_DEVICE> m_inputs;
+    LearnedModel m_model;
+    bool m_loaded;
+
+    PredictionScalar m_hiddenWeight[LEARNED_MAX_HIDDEN][LEARNED_MAX_INPUTS];
+    PredictionScalar m_hiddenBias[LEARNED_MAX_HIDDEN];
+    PredictionScalar m_outputWeight[LEARNED_MAX_HIDDEN];
+    PredictionScalar m_outputBias;
+    PredictionScalar m_outputScale;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+//==============================================================================
+/*
+    MedianFilter.h
+
+    Running median over the last 3, 5 or 7 samples of each lane.
+
+    The samples are kept in a ring of lane vectors and the median is taken
+    with a fixed sorting network of compare-exchange kernels, so all axes
+    are filtered together without data-dependent branches. Unlike holding
+    the previous value, a median rejects an isolated spike yet follows a
+    step change after half a window.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef MedianFilterH
+#define MedianFilterH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+//------------------------------------------------------------------------------
+
+template <typename T, int LANES>
+class MedianFilter
+{
+public:
+
+    typedef LaneVector<T, LANES> Vector;
+
+    // largest supported window [samples]
+    static const int MAX_WINDOW = 7;
+
+    MedianFilter(int a_window = 1)
+    {
+        setWindow(a_window);
+        reset();
+    }
+
+    // window of 1 (pass through), 3, 5 or 7 samples; other values are rounded down
+    // to one of these; the history is kept
+    void setWindow(int a_window)
+    {
+        if (a_window >= 7) { m_window = 7; }
+        else if (a_window >= 5) { m_window = 5; }
+        else if (a_window >= 3) { m_window = 3; }
+        else { m_window = 1; }
+    }
+
+    int getWindow() const { return m_window; }
+
+    // lag [samples] of the median on a ramp
+    int getLag() const { return m_window / 2; }
+
+    // forget the history; the next sample fills the whole ring
+    void reset()
+    {
+        m_next = 0;
+        m_empty = true;
+    }
+
+    // add a sample and replace it with the median of the window
+    void filter(Vector& a_value)
+    {
+        if (m_empty)
+        {
+            for (int n = 0; n < MAX_WINDOW; n++) { m_ring[n] = a_value; }
+            m_empty = false;
+        }
+        m_ring[m_next] = a_value;
+        m_next = (m_next + 1) % MAX_WINDOW;
+
+        // the latest m_window samples, in any order
+        Vector v[MAX_WINDOW];
+        for (int n = 0; n < m_window; n++)
+        {
+            v[n] = m_ring[(m_next + MAX_WINDOW - 1 - n) % MAX_WINDOW];
+        }
+
+        switch (m_window)
+        {
+            case 3:
+                compareExchangeLanes(v[0], v[1]);
+                compareExchangeLanes(v[1], v[2]);
+                compareExchangeLanes(v[0], v[1]);
+                a_value = v[1];
+                break;
+
+            case 5:
+                // median selection network, 7 compare-exchanges
+                compareExchangeLanes(v[0], v[1]);
+                compareExchangeLanes(v[3], v[4]);
+                compareExchangeLanes(v[0], v[3]);
+                compareExchangeLanes(v[1], v[4]);
+                compareExchangeLanes(v[1], v[2]);
+                compareExchangeLanes(v[2], v[3]);
+                compareExchangeLanes(v[1], v[2]);
+                a_value = v[2];
+                break;
+
+            case 7:
+                // optimal 7-input sorting network, 16 compare-exchanges
+                compareExchangeLanes(v[0], v[6]);
+                compareExchangeLanes(v[2], v[3]);
+                compareExchangeLanes(v[4], v[5]);
+                compareExchangeLanes(v[0], v[2]);
+                compareExchangeLanes(v[1], v[4]);
+                compareExchangeLanes(v[3], v[6]);
+                compareExchangeLanes(v[0], v[1]);
+                compareExchangeLanes(v[2], v[5]);
+                compareExchangeLanes(v[3], v[4]);
+                compareExchangeLanes(v[1], v[2]);
+                compareExchangeLanes(v[4], v[6]);
+                compareExchangeLanes(v[2], v[3]);
+                compareExchangeLanes(v[4], v[5]);
+                compareExchangeLanes(v[1], v[2]);
+                compareExchangeLanes(v[3], v[4]);
+                compareExchangeLanes(v[5], v[6]);
+                a_value = v[3];
+                break;
+
+            default:
+                break;
+        }
+    }
+
+private:
+
+    Vector m_ring[MAX_WINDOW];
+    int m_next;
+    bool m_empty;
+    int m_window;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,242 @@
+//==============================================================================
+/*
+    Metrics.h
+
+    Counters, gauges and latency summaries of the haptic loop, kept so that
+    recording them costs a few nanoseconds and no synchronization.
+
+    Every metric owns one slot (a summary owns one per latency bucket plus
+    its sum) in each thread's block of slots. A thread only writes its own
+    block, with relaxed atomic stores, and blocks are aligned to cache
+    lines so threads never share a line. A reader (the exporter) sums the
+    blocks of all threads when it renders the Prometheus text format.
+
+    Metrics are registered before the threads that write them start; a
+    gauge must be written by a single thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef MetricsH
+#define MetricsH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <string>
+//------------------------------------------------------------------------------
+
+class Metrics
+{
+public:
+
+    // capacity
+    static const int MAX_SLOTS = 256;
+    static const int MAX_METRICS = 64;
+    static const int MAX_THREADS = 4;
+
+    // summary buckets cover 2^MIN_EXPONENT (about 1 us) to 2^(MIN_EXPONENT + OCTAVES) seconds
+    static const int MIN_EXPONENT = -20;
+    static const int OCTAVES = 14;
+    static const int BUCKETS_PER_OCTAVE = 4;
+    static const int BUCKETS = OCTAVES * BUCKETS_PER_OCTAVE;
+
+    enum Type
+    {
+        METRIC_COUNTER,
+        METRIC_GAUGE,
+        METRIC_SUMMARY
+    };
+
+    Metrics() : m_numMetrics(0), m_numSlots(0)
+    {
+        for (int t = 0; t < MAX_THREADS; t++)
+        {
+            for (int s = 0; s < MAX_SLOTS; s++)
+            {
+                m_blocks[t].m_value[s].store(0.0);
+            }
+        }
+    }
+
+
+    //--------------------------------------------------------------------------
+    // REGISTRATION (before writer threads start)
+    //--------------------------------------------------------------------------
+
+    // register a metric, returns its handle or -1 if full
+    // a_labels: Prometheus labels without braces, e.g. axis="x"; metrics sharing a name
+    // must be registered one after the other
+    int addCounter(const char* a_name, const char* a_help, const char* a_labels = "") { return registerMetric(METRIC_COUNTER, a_name, a_help, a_labels, 1); }
+    int addGauge(const char* a_name, const char* a_help, const char* a_labels = "") { return registerMetric(METRIC_GAUGE, a_name, a_help, a_labels, 1); }
+    int addSummary(const char* a_name, const char* a_help, const char* a_labels = "") { return registerMetric(METRIC_SUMMARY, a_name, a_help, a_labels, BUCKETS + 1); }
+
+
+    //--------------------------------------------------------------------------
+    // RECORDING (thread a_thread only)
+    //--------------------------------------------------------------------------
+
+    // increment a counter
+    void add(int a_thread, int a_metric, double a_delta = 1.0)
+    {
+        std::atomic<double>& slot = m_blocks[a_thread].m_value[m_metrics[a_metric].m_slot];
+        slot.store(slot.load(std::memory_order_relaxed) + a_delta, std::memory_order_relaxed);
+    }
+
+    // set a gauge, or a counter maintained elsewhere
+    void set(int a_thread, int a_metric, double a_value)
+    {
+        m_blocks[a_thread].m_value[m_metrics[a_metric].m_slot].store(a_value, std::memory_order_relaxed);
+    }
+
+    // record one observation [s] of a summary
+    void observe(int a_thread, int a_metric, double a_seconds)
+    {
+        std::atomic<double>* values = &m_blocks[a_thread].m_value[m_metrics[a_metric].m_slot];
+        std::atomic<double>& count = values[bucket(a_seconds)];
+        count.store(count.load(std::memory_order_relaxed) + 1.0, std::memory_order_relaxed);
+        values[BUCKETS].store(values[BUCKETS].load(std::memory_order_relaxed) + a_seconds, std::memory_order_relaxed);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // EXPORT (any thread)
+    //--------------------------------------------------------------------------
+
+    // render all metrics in the Prometheus text exposition format
+    void writeText(std::string& a_text) const
+    {
+        a_text.clear();
+        char line[512];
+
+        for (int m = 0; m < m_numMetrics; m++)
+        {
+            const Metric& metric = m_metrics[m];
+            bool braces = !metric.m_labels.empty();
+
+            if (m == 0 || metric.m_name != m_metrics[m - 1].m_name)
+            {
+                const char* type = (metric.m_type == METRIC_COUNTER) ? "counter" : (metric.m_type == METRIC_GAUGE) ? "gauge" : "summary";
+                snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", metric.m_name.c_str(), metric.m_help.c_str(), metric.m_name.c_str(), type);
+                a_text += line;
+            }
+
+            if (metric.m_type != METRIC_SUMMARY)
+            {
+                snprintf(line, sizeof(line), "%s%s%s%s %.17g\n", metric.m_name.c_str(), braces ? "{" : "",
+                         metric.m_labels.c_str(), braces ? "}" : "", sum(metric.m_slot));
+                a_text += line;
+                continue;
+            }
+
+            // summary: quantiles interpolated in the merged buckets, then sum and count
+            double counts[BUCKETS];
+            double count = 0.0;
+            for (int b = 0; b < BUCKETS; b++)
+            {
+                counts[b] = sum(metric.m_slot + b);
+                count += counts[b];
+            }
+
+            const double quantiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+            for (int q = 0; q < 4; q++)
+            {
+                snprintf(line, sizeof(line), "%s{%s%squantile=\"%g\"} %.9g\n", metric.m_name.c_str(), metric.m_labels.c_str(),
+                         braces ? "," : "", quantiles[q], quantile(counts, count, quantiles[q]));
+                a_text += line;
+            }
+            snprintf(line, sizeof(line), "%s_sum%s%s%s %.9g\n%s_count%s%s%s %.17g\n",
+                     metric.m_name.c_str(), braces ? "{" : "", metric.m_labels.c_str(), braces ? "}" : "", sum(metric.m_slot + BUCKETS),
+                     metric.m_name.c_str(), braces ? "{" : "", metric.m_labels.c_str(), braces ? "}" : "", count);
+            a_text += line;
+        }
+    }
+
+private:
+
+    struct Metric
+    {
+        Type m_type;
+        std::string m_name;
+        std::string m_help;
+        std::string m_labels;
+        int m_slot;
+    };
+
+    // slots of one thread, on cache lines of their own
+    struct alignas(64) Block
+    {
+        std::atomic<double> m_value[MAX_SLOTS];
+    };
+
+    int registerMetric(Type a_type, const char* a_name, const char* a_help, const char* a_labels, int a_slots)
+    {
+        if (m_numMetrics == MAX_METRICS || m_numSlots + a_slots > MAX_SLOTS) { return -1; }
+
+        Metric& metric = m_metrics[m_numMetrics];
+        metric.m_type = a_type;
+        metric.m_name = a_name;
+        metric.m_help = a_help;
+        metric.m_labels = a_labels;
+        metric.m_slot = m_numSlots;
+        m_numSlots += a_slots;
+        return m_numMetrics++;
+    }
+
+    // value of a slot summed over all threads
+    double sum(int a_slot) const
+    {
+        double value = 0.0;
+        for (int t = 0; t < MAX_THREADS; t++)
+        {
+            value += m_blocks[t].m_value[a_slot].load(std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    // bucket of a duration, from its binary exponent and two mantissa bits
+    static int bucket(double a_seconds)
+    {
+        int exponent;
+        double mantissa = frexp(a_seconds, &exponent);
+        int index = (exponent - 1 - MIN_EXPONENT) * BUCKETS_PER_OCTAVE + (int)((mantissa - 0.5) * 2.0 * BUCKETS_PER_OCTAVE);
+        if (a_seconds <= 0.0 || index < 0) { return 0; }
+        if (index >= BUCKETS) { return BUCKETS - 1; }
+        return index;
+    }
+
+    // lower edge [s] of a bucket
+    static double bucketEdge(int a_index)
+    {
+        return ldexp(1.0 + (double)(a_index % BUCKETS_PER_OCTAVE) / BUCKETS_PER_OCTAVE, a_index / BUCKETS_PER_OCTAVE + MIN_EXPONENT);
+    }
+
+    static double quantile(const double a_counts[BUCKETS], double a_count, double a_fraction)
+    {
+        if (a_count == 0.0) { return 0.0; }
+
+        double target = a_fraction * a_count;
+        double cumulated = 0.0;
+        for (int b = 0; b < BUCKETS; b++)
+        {
+            if (cumulated + a_counts[b] >= target && a_counts[b] > 0.0)
+            {
+                double lower = (b > 0) ? bucketEdge(b) : 0.0;
+                double upper = bucketEdge(b + 1);
+                return lower + (upper - lower) * (target - cumulated) / a_counts[b];
+            }
+            cumulated += a_counts[b];
+        }
+        return bucketEdge(BUCKETS);
+    }
+
+    Metric m_metrics[MAX_METRICS];
+    int m_numMetrics;
+    int m_numSlots;
+
+    Block m_blocks[MAX_THREADS];
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,203 @@
+//==============================================================================
+/*
+    MetricsExporter.h
+
+    Low-priority thread publishing a Metrics registry in the Prometheus text
+    format, to a file (for the node exporter textfile collector or for
+    copying off a rig) and, on POSIX systems, over HTTP on a local port.
+
+    The file is written to a temporary name and renamed, so readers never
+    see a partial file. The HTTP server answers every request on the socket
+    with the current metrics and closes the connection; it only binds to
+    the loopback interface.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef MetricsExporterH
+#define MetricsExporterH
+//------------------------------------------------------------------------------
+#include "Metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+//------------------------------------------------------------------------------
+
+class MetricsExporter
+{
+public:
+
+    MetricsExporter(const Metrics& a_metrics) : m_metrics(a_metrics), m_port(0), m_period(1.0), m_socket(-1)
+    {
+        m_running.store(false);
+    }
+
+    ~MetricsExporter() { stop(); }
+
+    // start publishing every a_period [s] to a_filename (NULL: no file) and serving
+    // http://127.0.0.1:a_port/metrics (0: no server, POSIX only); false if the port cannot be opened
+    bool start(const char* a_filename, int a_port, double a_period = 1.0)
+    {
+        stop();
+
+        m_filename = (a_filename != NULL) ? a_filename : "";
+        m_port = a_port;
+        m_period = a_period;
+        if (m_port > 0 && !openSocket()) { return false; }
+
+        m_running.store(true);
+        m_thread = std::thread(&MetricsExporter::run, this);
+        return true;
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable()) { return; }
+
+        m_running.store(false);
+        m_thread.join();
+        closeSocket();
+    }
+
+private:
+
+    void run()
+    {
+        lowerPriority();
+
+        std::string text;
+        while (m_running.load())
+        {
+            m_metrics.writeText(text);
+            if (!m_filename.empty()) { writeFile(text); }
+
+            // serve requests until the next file update
+            std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(m_period));
+            while (m_running.load() && std::chrono::steady_clock::now() < next)
+            {
+                if (!serve()) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+            }
+        }
+    }
+
+    void writeFile(const std::string& a_text)
+    {
+        std::string temporary = m_filename + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "w");
+        if (file == NULL) { return; }
+        fwrite(a_text.data(), 1, a_text.size(), file);
+        fclose(file);
+#ifdef _WIN32
+        MoveFileExA(temporary.c_str(), m_filename.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+        rename(temporary.c_str(), m_filename.c_str());
+#endif
+    }
+
+    void lowerPriority()
+    {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+        // the nice value is per thread on Linux
+        setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+    }
+
+#ifdef _WIN32
+
+    bool openSocket() { return false; }
+    void closeSocket() {}
+    bool serve() { return false; }
+
+#else
+
+    bool openSocket()
+    {
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_socket < 0) { return false; }
+
+        int reuse = 1;
+        setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)m_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(m_socket, (sockaddr*)&address, sizeof(address)) != 0 || listen(m_socket, 4) != 0)
+        {
+            closeSocket();
+            return false;
+        }
+        return true;
+    }
+
+    void closeSocket()
+    {
+        if (m_socket >= 0) { ::close(m_socket); }
+        m_socket = -1;
+    }
+
+    // answer one pending request (waits up to 100 ms), returns false if there is no server
+    bool serve()
+    {
+        if (m_socket < 0) { return false; }
+
+        pollfd descriptor = { m_socket, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0) { return true; }
+
+        int connection = accept(m_socket, NULL, NULL);
+        if (connection < 0) { return true; }
+
+        // the request itself is not needed; read it so the client sees an orderly reply
+        char request[1024];
+        pollfd client = { connection, POLLIN, 0 };
+        if (poll(&client, 1, 100) > 0) { (void)recv(connection, request, sizeof(request), 0); }
+
+        std::string text;
+        m_metrics.writeText(text);
+        char header[160];
+        int length = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                              (unsigned int)text.size());
+        (void)send(connection, header, length, MSG_NOSIGNAL);
+        (void)send(connection, text.data(), text.size(), MSG_NOSIGNAL);
+        ::close(connection);
+        return true;
+    }
+
+#endif
+
+    const Metrics& m_metrics;
+    std::string m_filename;
+    int m_port;
+    double m_period;
+    int m_socket;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+//==============================================================================
+/*
+    MotionPredictor.h
+
+    Common interface of the position predictors.
+
+    A predictor is fed one device sample per prediction tick and can then be
+    asked for the position and velocity expected a given horizon ahead of
+    the latest sample. Implementations keep all their state in fixed size
+    members and never allocate after construction.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef MotionPredictorH
+#define MotionPredictorH
+//------------------------------------------------------------------------------
+
+// one device sample as seen by a predictor
+struct MotionSample
+{
+    double m_time;              // [s]
+    double m_position[3];       // [m]
+    double m_velocity[3];       // velocity reported by the device [m/s]
+};
+
+// output of a predictor for a given horizon
+struct MotionPrediction
+{
+    double m_position[3];       // [m]
+    double m_velocity[3];       // [m/s]
+};
+
+//------------------------------------------------------------------------------
+
+class MotionPredictor
+{
+public:
+
+    virtual ~MotionPredictor() {}
+
+    // short name used in logs, HUD and reports
+    virtual const char* getName() const = 0;
+
+    // forget all past samples
+    virtual void reset() = 0;
+
+    // feed the next sample
+    virtual void update(const MotionSample& a_sample) = 0;
+
+    // position and velocity expected a_horizon [s] after the latest sample
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const = 0;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
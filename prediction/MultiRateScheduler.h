@@ -0,0 +1,151 @@
+//==============================================================================
+/*
+    MultiRateScheduler.h
+
+    Building blocks for running the stages of the haptic loop at individual
+    rates: a scheduler that decides which stages are due on a tick, and a
+    second order Butterworth low-pass used as anti-aliasing filter before a
+    signal is decimated to a slower stage.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef MultiRateSchedulerH
+#define MultiRateSchedulerH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// SCHEDULER
+//------------------------------------------------------------------------------
+
+class MultiRateScheduler
+{
+public:
+
+    // maximum number of stages
+    static const int MAX_STAGES = 8;
+
+    MultiRateScheduler() : m_numStages(0) {}
+
+    // register a stage running at a_rate [Hz], returns its index (-1 if full)
+    int addStage(double a_rate)
+    {
+        if (m_numStages == MAX_STAGES) { return -1; }
+
+        int stage = m_numStages++;
+        m_period[stage] = 1.0 / a_rate;
+        m_next[stage] = 0.0;
+        m_missed[stage] = 0;
+        return stage;
+    }
+
+    // true if a_stage is due at time a_time [s]; consumes the slot
+    bool isDue(int a_stage, double a_time)
+    {
+        if (a_time < m_next[a_stage]) { return false; }
+
+        // late by more than a period: skip the missed slots instead of bursting
+        double next = m_next[a_stage] + m_period[a_stage];
+        if (next <= a_time)
+        {
+            if (m_next[a_stage] > 0.0) { m_missed[a_stage]++; }
+            next = a_time + m_period[a_stage];
+        }
+        m_next[a_stage] = next;
+        return true;
+    }
+
+    // configured rate [Hz] of a stage
+    double getRate(int a_stage) const { return 1.0 / m_period[a_stage]; }
+
+    // number of slots a stage has skipped because the loop was late
+    unsigned long getMissed(int a_stage) const { return m_missed[a_stage]; }
+
+private:
+
+    int m_numStages;
+    double m_period[MAX_STAGES];
+    double m_next[MAX_STAGES];
+    unsigned long m_missed[MAX_STAGES];
+};
+
+
+//------------------------------------------------------------------------------
+// ANTI-ALIASING FILTER
+//------------------------------------------------------------------------------
+
+template <typename T = double>
+class LowPassBiquad
+{
+public:
+
+    // x/y/z of one sample packed in lanes
+    typedef LaneVector<T, LANES_PER_DEVICE> Lanes;
+
+    LowPassBiquad() { design(1000.0, 100.0); }
+
+    // second order Butterworth low-pass (bilinear transform, cutoff prewarped)
+    void design(double a_sampleRate, double a_cutoff)
+    {
+        const double pi = 3.14159265358979323846;
+        double k = tan(pi * a_cutoff / a_sampleRate);
+        double q = 1.0 / sqrt(2.0);
+        double norm = 1.0 / (1.0 + k / q + k * k);
+
+        m_b0 = (T)(k * k * norm);
+        m_b1 = (T)(2.0 * k * k * norm);
+        m_b2 = m_b0;
+        m_a1 = (T)(2.0 * (k * k - 1.0) * norm);
+        m_a2 = (T)((1.0 - k / q + k * k) * norm);
+
+        m_initialized = false;
+    }
+
+    // filter one sample per axis
+    void filter(const double a_input[3], double a_output[3])
+    {
+        Lanes input, output;
+        input.load(a_input);
+        filter(input, output);
+        output.store(a_output);
+    }
+
+    // filter one sample packed in lanes (direct form II transposed)
+    void filter(const Lanes& a_input, Lanes& a_output)
+    {
+        // start from the steady state of the first sample to avoid a transient
+        if (!m_initialized)
+        {
+            for (int i = 0; i < LANES_PER_DEVICE; i++)
+            {
+                m_z2.m_value[i] = (m_b2 - m_a2) * a_input.m_value[i];
+                m_z1.m_value[i] = (m_b1 - m_a1) * a_input.m_value[i] + m_z2.m_value[i];
+            }
+            m_initialized = true;
+        }
+
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            T x = a_input.m_value[i];
+            T y = m_b0 * x + m_z1.m_value[i];
+            m_z1.m_value[i] = m_b1 * x - m_a1 * y + m_z2.m_value[i];
+            m_z2.m_value[i] = m_b2 * x - m_a2 * y;
+            a_output.m_value[i] = y;
+        }
+    }
+
+private:
+
+    T m_b0, m_b1, m_b2;
+    T m_a1, m_a2;
+    Lanes m_z1;
+    Lanes m_z2;
+    bool m_initialized;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+//==============================================================================
+/*
+    OneEuroFilter.h
+
+    One Euro filter (Casiez, Roussel and Vogel, CHI 2012) on every lane: a
+    first order low-pass whose cutoff rises with the rate of change of the
+    signal, so it smooths hard when the signal is steady and follows
+    quickly when it moves.
+
+        cutoff = min cutoff + beta * |filtered derivative|
+        alpha  = 1 / (1 + 1 / (2 pi cutoff dt))
+
+    The sample period is fixed when the filter is configured, so alpha is
+    read from a table over the cutoff (up to the Nyquist frequency) with
+    linear interpolation, and the derivative filter has a constant alpha.
+    Filtering a sample takes no division and no allocation.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef OneEuroFilterH
+#define OneEuroFilterH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+template <typename T, int LANES>
+class OneEuroFilter
+{
+public:
+
+    typedef LaneVector<T, LANES> Vector;
+
+    // entries of the alpha table
+    static const int TABLE_SIZE = 256;
+
+    // a_minCutoff [Hz], a_beta [Hz per unit/s], a_derivativeCutoff [Hz], a_rate: sample rate [Hz]
+    OneEuroFilter(double a_minCutoff = 1.0, double a_beta = 0.0, double a_derivativeCutoff = 1.0, double a_rate = 1000.0)
+    {
+        configure(a_minCutoff, a_beta, a_derivativeCutoff, a_rate);
+        reset();
+    }
+
+    // set the parameters and rebuild the alpha table; the state is kept
+    void configure(double a_minCutoff, double a_beta, double a_derivativeCutoff, double a_rate)
+    {
+        m_minCutoff = a_minCutoff;
+        m_beta = a_beta;
+        m_derivativeCutoff = a_derivativeCutoff;
+        m_rate = a_rate;
+
+        double nyquist = 0.5 * a_rate;
+        for (int n = 0; n < TABLE_SIZE; n++)
+        {
+            m_alpha[n] = (T)alpha(nyquist * n / (TABLE_SIZE - 1), a_rate);
+        }
+        m_cutoffToIndex = (T)((TABLE_SIZE - 1) / nyquist);
+        m_derivativeAlpha = (T)alpha(a_derivativeCutoff, a_rate);
+    }
+
+    double getMinCutoff() const { return m_minCutoff; }
+    double getBeta() const { return m_beta; }
+    double getDerivativeCutoff() const { return m_derivativeCutoff; }
+    double getRate() const { return m_rate; }
+
+    // lag [s] of the filter on a steady signal (time constant at the minimum cutoff)
+    double getRestLag() const { return 1.0 / (2.0 * M_PI * m_minCutoff); }
+
+    // forget the history; the next sample passes unfiltered
+    void reset() { m_empty = true; }
+
+    // replace a sample with its filtered value
+    void filter(Vector& a_value)
+    {
+        if (m_empty)
+        {
+            m_value = a_value;
+            m_derivative.fill(0);
+            m_empty = false;
+            return;
+        }
+
+        T rate = (T)m_rate;
+        T minCutoff = (T)m_minCutoff;
+        T beta = (T)m_beta;
+        T last = (T)(TABLE_SIZE - 1);
+        for (int i = 0; i < LANES; i++)
+        {
+            T x = a_value.m_value[i];
+
+            // smoothed rate of change
+            T derivative = (x - m_value.m_value[i]) * rate;
+            T dx = m_derivative.m_value[i] + m_derivativeAlpha * (derivative - m_derivative.m_value[i]);
+            m_derivative.m_value[i] = dx;
+
+            // cutoff -> table position, clamped to the Nyquist frequency
+            T position = (minCutoff + beta * std::abs(dx)) * m_cutoffToIndex;
+            position = (position < last) ? position : last;
+            int index = (int)position;
+            index = (index < TABLE_SIZE - 2) ? index : TABLE_SIZE - 2;
+            T fraction = position - (T)index;
+            T a = m_alpha[index] + fraction * (m_alpha[index + 1] - m_alpha[index]);
+
+            m_value.m_value[i] += a * (x - m_value.m_value[i]);
+        }
+        a_value = m_value;
+    }
+
+private:
+
+    // smoothing factor of a first order low-pass at a_cutoff [Hz]
+    static double alpha(double a_cutoff, double a_rate)
+    {
+        double omega = 2.0 * M_PI * a_cutoff / a_rate;
+        return omega / (1.0 + omega);
+    }
+
+    Vector m_value;
+    Vector m_derivative;
+    bool m_empty;
+
+    double m_minCutoff;
+    double m_beta;
+    double m_derivativeCutoff;
+    double m_rate;
+
+    T m_alpha[TABLE_SIZE];
+    T m_cutoffToIndex;
+    T m_derivativeAlpha;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,326 @@
+//==============================================================================
+/*
+    PredictionErrorTracker.h
+
+    Live accuracy measurement of a position predictor.
+
+    Every prediction is queued together with the time it refers to. Once the
+    haptic clock reaches that time, the prediction is compared with the
+    position actually measured and per-axis streaming statistics (RMSE,
+    maximum and a log-binned histogram for quantiles) are updated.
+
+    Queue operations and histogram updates are constant time; at most a
+    fixed number of matured predictions is resolved per tick. Summaries are
+    published to other threads through a sequence lock: the haptic thread
+    never waits, and a reader copies the snapshot again if a publish
+    overlapped its copy, so it never sees a torn one. The statistics
+    themselves can be merged, so runs evaluated separately (offline, on
+    several threads) combine into one summary.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef PredictionErrorTrackerH
+#define PredictionErrorTrackerH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+//------------------------------------------------------------------------------
+
+// snapshot of the error statistics [m], safe to hand to another thread
+struct PredictionErrorSummary
+{
+    unsigned long long m_count;
+    unsigned long long m_dropped;
+    double m_rmse[3];
+    double m_max[3];
+    double m_p50[3];
+    double m_p95[3];
+    double m_p99[3];
+};
+
+//------------------------------------------------------------------------------
+// STATISTICS
+//------------------------------------------------------------------------------
+
+// per-axis error statistics; statistics of separate runs can be merged
+class PredictionErrorStatistics
+{
+public:
+
+    // histogram covers errors from 2^MIN_EXPONENT to 1 m with 4 bins per octave
+    static const int MIN_EXPONENT = -20;
+    static const int BINS_PER_OCTAVE = 4;
+    static const int BINS = -MIN_EXPONENT * BINS_PER_OCTAVE;
+
+    PredictionErrorStatistics() { reset(); }
+
+    void reset()
+    {
+        m_count = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            m_sumSquares[i] = 0.0;
+            m_max[i] = 0.0;
+            for (int j = 0; j < BINS; j++)
+            {
+                m_histogram[i][j] = 0;
+            }
+        }
+    }
+
+    // add the error of one prediction: measured minus predicted position [m]
+    void add(const double a_measured[3], const double a_predicted[3])
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            double error = fabs(a_measured[i] - a_predicted[i]);
+            m_sumSquares[i] += error * error;
+            if (error > m_max[i]) { m_max[i] = error; }
+            m_histogram[i][bin(error)]++;
+        }
+        m_count++;
+    }
+
+    // add the statistics of another run
+    void merge(const PredictionErrorStatistics& a_other)
+    {
+        m_count += a_other.m_count;
+        for (int i = 0; i < 3; i++)
+        {
+            m_sumSquares[i] += a_other.m_sumSquares[i];
+            if (a_other.m_max[i] > m_max[i]) { m_max[i] = a_other.m_max[i]; }
+            for (int j = 0; j < BINS; j++)
+            {
+                m_histogram[i][j] += a_other.m_histogram[i][j];
+            }
+        }
+    }
+
+    unsigned long long getCount() const { return m_count; }
+
+    // fill everything but the drop count of a summary
+    void summarize(PredictionErrorSummary& a_summary) const
+    {
+        a_summary.m_count = m_count;
+        for (int i = 0; i < 3; i++)
+        {
+            a_summary.m_rmse[i] = (m_count > 0) ? sqrt(m_sumSquares[i] / m_count) : 0.0;
+            a_summary.m_max[i] = m_max[i];
+            a_summary.m_p50[i] = quantile(i, 0.50);
+            a_summary.m_p95[i] = quantile(i, 0.95);
+            a_summary.m_p99[i] = quantile(i, 0.99);
+        }
+    }
+
+    // error quantile [m] of one axis, interpolated inside the histogram bin
+    double quantile(int a_axis, double a_fraction) const
+    {
+        if (m_count == 0) { return 0.0; }
+
+        double target = a_fraction * m_count;
+        double cumulated = 0.0;
+        for (int j = 0; j < BINS; j++)
+        {
+            double inBin = (double)m_histogram[a_axis][j];
+            if (cumulated + inBin >= target && inBin > 0.0)
+            {
+                double lower = (j > 0) ? binEdge(j) : 0.0;
+                double upper = (j + 1 < BINS) ? binEdge(j + 1) : m_max[a_axis];
+                return lower + (upper - lower) * (target - cumulated) / inBin;
+            }
+            cumulated += inBin;
+        }
+        return m_max[a_axis];
+    }
+
+private:
+
+    // histogram bin of an error, from its binary exponent and two mantissa bits
+    static int bin(double a_error)
+    {
+        if (a_error < 1.0 / (1 << -MIN_EXPONENT)) { return 0; }
+
+        int exponent;
+        double mantissa = frexp(a_error, &exponent);    // a_error = mantissa * 2^exponent, mantissa in [0.5, 1)
+        int index = (exponent - 1 - MIN_EXPONENT) * BINS_PER_OCTAVE + (int)((mantissa - 0.5) * 2.0 * BINS_PER_OCTAVE);
+        if (index < 0) { return 0; }
+        if (index >= BINS) { return BINS - 1; }
+        return index;
+    }
+
+    // lower edge [m] of a histogram bin
+    static double binEdge(int a_index)
+    {
+        int octave = a_index / BINS_PER_OCTAVE;
+        int step = a_index % BINS_PER_OCTAVE;
+        return ldexp(1.0 + (double)step / BINS_PER_OCTAVE, octave + MIN_EXPONENT);
+    }
+
+    unsigned long long m_count;
+    double m_sumSquares[3];
+    double m_max[3];
+    unsigned int m_histogram[3][BINS];
+};
+
+
+//------------------------------------------------------------------------------
+// TRACKER
+//------------------------------------------------------------------------------
+
+template <int CAPACITY>
+class PredictionErrorTracker
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+
+    // upper bound of matured predictions resolved per tick
+    static const int MAX_RESOLVE_PER_TICK = 4;
+
+    PredictionErrorTracker()
+    {
+        m_sequence.store(0);
+        reset();
+        publish();
+    }
+
+    // clear queue and statistics (haptic thread)
+    void reset()
+    {
+        m_head = 0;
+        m_tail = 0;
+        m_dropped = 0;
+        m_statistics.reset();
+    }
+
+    // queue a predicted position [m] for a_targetTime [s] (haptic thread)
+    void push(double a_targetTime, const double a_position[3])
+    {
+        if (m_head - m_tail == CAPACITY)
+        {
+            m_tail++;
+            m_dropped++;
+        }
+
+        Entry& entry = m_queue[m_head & (CAPACITY - 1)];
+        entry.m_time = a_targetTime;
+        entry.m_position[0] = a_position[0];
+        entry.m_position[1] = a_position[1];
+        entry.m_position[2] = a_position[2];
+        m_head++;
+    }
+
+    // compare matured predictions with the position [m] measured at a_time [s] (haptic thread)
+    void update(double a_time, const double a_position[3])
+    {
+        for (int n = 0; n < MAX_RESOLVE_PER_TICK; n++)
+        {
+            if (m_tail == m_head) { return; }
+
+            const Entry& entry = m_queue[m_tail & (CAPACITY - 1)];
+            if (entry.m_time > a_time) { return; }
+
+            m_statistics.add(a_position, entry.m_position);
+            m_tail++;
+        }
+    }
+
+    // compute and publish a summary for other threads (haptic thread, at low rate)
+    void publish()
+    {
+        PredictionErrorSummary summary;
+        m_statistics.summarize(summary);
+        summary.m_dropped = m_dropped;
+
+        uint64_t words[SUMMARY_WORDS];
+        memcpy(words, &summary, sizeof(summary));
+
+        // odd while the words change
+        unsigned long long sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int n = 0; n < SUMMARY_WORDS; n++)
+        {
+            m_summary[n].store(words[n], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // latest published summary (any thread; retries while a publish overlaps the copy)
+    PredictionErrorSummary getSummary() const
+    {
+        uint64_t words[SUMMARY_WORDS];
+        unsigned long long before, after;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (int n = 0; n < SUMMARY_WORDS; n++)
+            {
+                words[n] = m_summary[n].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        }
+        while ((before & 1) != 0 || before != after);
+
+        PredictionErrorSummary summary;
+        memcpy(&summary, words, sizeof(summary));
+        return summary;
+    }
+
+    // statistics accumulated so far (haptic thread)
+    const PredictionErrorStatistics& getStatistics() const { return m_statistics; }
+
+    // predictions dropped because the queue was full (haptic thread)
+    unsigned long long getDropped() const { return m_dropped; }
+
+    // write the latest published summary as CSV, returns false if the file cannot be opened
+    bool exportCsv(const char* a_filename) const
+    {
+        FILE* file = fopen(a_filename, "w");
+        if (file == NULL) { return false; }
+
+        PredictionErrorSummary summary = getSummary();
+        fprintf(file, "axis,count,dropped,rmse_m,max_m,p50_m,p95_m,p99_m\n");
+        const char* axis[3] = { "x", "y", "z" };
+        for (int i = 0; i < 3; i++)
+        {
+            fprintf(file, "%s,%llu,%llu,%.9g,%.9g,%.9g,%.9g,%.9g\n", axis[i],
+                    summary.m_count, summary.m_dropped, summary.m_rmse[i], summary.m_max[i],
+                    summary.m_p50[i], summary.m_p95[i], summary.m_p99[i]);
+        }
+
+        fclose(file);
+        return true;
+    }
+
+private:
+
+    // the published summary is copied as whole words
+    static_assert(sizeof(PredictionErrorSummary) % sizeof(uint64_t) == 0, "summary must be a whole number of words");
+    static const int SUMMARY_WORDS = (int)(sizeof(PredictionErrorSummary) / sizeof(uint64_t));
+
+    struct Entry
+    {
+        double m_time;
+        double m_position[3];
+    };
+
+    Entry m_queue[CAPACITY];
+    unsigned long long m_head;
+    unsigned long long m_tail;
+    unsigned long long m_dropped;
+
+    PredictionErrorStatistics m_statistics;
+
+    std::atomic<uint64_t> m_summary[SUMMARY_WORDS];
+    std::atomic<unsigned long long> m_sequence;   // even: m_summary complete
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
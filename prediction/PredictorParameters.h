@@ -0,0 +1,230 @@
+//==============================================================================
+/*
+    PredictorParameters.h
+
+    Tunable predictor parameters and their text file format:
+
+        # comment
+        velocity_limit   = 0.05 0.05 0.05   # per-axis velocity limit [m/s]
+        jitter_threshold = 0.009            # fixed jitter threshold [m/s]
+        stop_threshold   = 0.001            # stop threshold on the L1 velocity [m/s]
+        average_cycle    = 31               # running average cycle [samples]
+        median_window    = 1                # threshold median prefilter: 1 (off), 3, 5, 7
+                                            # (left to the program when missing)
+        one_euro         = 10 50 10         # One Euro velocity filter: min cutoff [Hz],
+                                            # beta [Hz per m/s^2], derivative cutoff [Hz]
+        tracker_memory   = 0.05             # alpha-beta-gamma fading memory [s]
+        ema_time_constant = 0.015           # exponential average time constant [s]
+        rls_forgetting   = 0.999            # RLS autoregressive forgetting factor (0, 1]
+
+    Keys missing from a file keep their default value; a missing median
+    window stays 0 and leaves the window the predictor has (a program can
+    choose it at run time). A block is immutable
+    once parsed, so a thread that holds one always sees a complete set.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef PredictorParametersH
+#define PredictorParametersH
+//------------------------------------------------------------------------------
+#include "AlphaBetaGammaPredictor.h"
+#include "ExponentialAverage.h"
+#include "LearnedPredictor.h"
+#include "Predictors.h"
+#include "RlsArPredictor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+//------------------------------------------------------------------------------
+
+struct PredictorParameters
+{
+    PredictorParameters()
+    {
+        m_velocityLimit[0] = m_velocityLimit[1] = m_velocityLimit[2] = DEFAULT_VELOCITY_LIMIT;
+        m_jitterThreshold = DEFAULT_JITTER_THRESHOLD;
+        m_stopThreshold = DEFAULT_STOP_THRESHOLD;
+        m_averageCycle = RunningAveragePredictor::CYCLE;
+        m_medianWindow = 0;
+        m_oneEuroMinCutoff = 10.0;
+        m_oneEuroBeta = 50.0;
+        m_oneEuroDerivativeCutoff = 10.0;
+        m_trackerMemory = DEFAULT_TRACKER_MEMORY;
+        m_emaTimeConstant = DEFAULT_EMA_TIME_CONSTANT;
+        m_rlsForgetting = DEFAULT_RLS_FORGETTING;
+    }
+
+    double m_velocityLimit[3];
+    double m_jitterThreshold;
+    double m_stopThreshold;
+    int m_averageCycle;
+    int m_medianWindow;                     // 0: not set
+    double m_oneEuroMinCutoff;
+    double m_oneEuroBeta;
+    double m_oneEuroDerivativeCutoff;
+    double m_trackerMemory;
+    double m_emaTimeConstant;
+    double m_rlsForgetting;
+};
+
+//------------------------------------------------------------------------------
+
+// parse a parameter file, returns false and a message naming the line on error
+inline bool parsePredictorParameters(const std::string& a_text, PredictorParameters& a_parameters, std::string& a_error)
+{
+    PredictorParameters parameters;
+    size_t begin = 0;
+    int lineNumber = 0;
+    char message[160];
+
+    while (begin < a_text.size())
+    {
+        size_t end = a_text.find('\n', begin);
+        if (end == std::string::npos) { end = a_text.size(); }
+        std::string line = a_text.substr(begin, end - begin);
+        begin = end + 1;
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) { line.erase(comment); }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+
+        char key[64];
+        char rest[128];
+        double values[3];
+        int numValues = 0;
+        if (sscanf(line.c_str(), " %63[a-z_] = %127[^\n]", key, rest) == 2)
+        {
+            numValues = sscanf(rest, "%lf %lf %lf", &values[0], &values[1], &values[2]);
+        }
+
+        bool valid = (numValues > 0);
+        for (int n = 0; n < numValues; n++)
+        {
+            valid = valid && (values[n] > 0.0);
+        }
+
+        if (valid && strcmp(key, "velocity_limit") == 0 && numValues == 3)
+        {
+            for (int i = 0; i < 3; i++) { parameters.m_velocityLimit[i] = values[i]; }
+        }
+        else if (valid && strcmp(key, "jitter_threshold") == 0 && numValues == 1)
+        {
+            parameters.m_jitterThreshold = values[0];
+        }
+        else if (valid && strcmp(key, "stop_threshold") == 0 && numValues == 1)
+        {
+            parameters.m_stopThreshold = values[0];
+        }
+        else if (valid && strcmp(key, "average_cycle") == 0 && numValues == 1 && values[0] >= 2.0 && values[0] <= 10000.0)
+        {
+            parameters.m_averageCycle = (int)values[0];
+        }
+        else if (valid && strcmp(key, "median_window") == 0 && numValues == 1 &&
+                 (values[0] == 1.0 || values[0] == 3.0 || values[0] == 5.0 || values[0] == 7.0))
+        {
+            parameters.m_medianWindow = (int)values[0];
+        }
+        else if (valid && strcmp(key, "one_euro") == 0 && numValues == 3)
+        {
+            parameters.m_oneEuroMinCutoff = values[0];
+            parameters.m_oneEuroBeta = values[1];
+            parameters.m_oneEuroDerivativeCutoff = values[2];
+        }
+        else if (valid && strcmp(key, "tracker_memory") == 0 && numValues == 1)
+        {
+            parameters.m_trackerMemory = values[0];
+        }
+        else if (valid && strcmp(key, "ema_time_constant") == 0 && numValues == 1)
+        {
+            parameters.m_emaTimeConstant = values[0];
+        }
+        else if (valid && strcmp(key, "rls_forgetting") == 0 && numValues == 1 && values[0] <= 1.0)
+        {
+            parameters.m_rlsForgetting = values[0];
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "line %d: expected <key> = <positive value(s)>", lineNumber);
+            a_error = message;
+            return false;
+        }
+    }
+
+    a_parameters = parameters;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// read and parse a parameter file
+inline bool loadPredictorParameters(const char* a_filename, PredictorParameters& a_parameters, std::string& a_error)
+{
+    FILE* file = fopen(a_filename, "rb");
+    if (file == NULL)
+    {
+        a_error = std::string("cannot read ") + a_filename;
+        return false;
+    }
+
+    std::string text;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, size);
+    }
+    fclose(file);
+
+    return parsePredictorParameters(text, a_parameters, a_error);
+}
+
+//------------------------------------------------------------------------------
+
+// copy the parameters a predictor uses into it
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, ThresholdPredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setJitterThreshold(a_parameters.m_jitterThreshold);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+    if (a_parameters.m_medianWindow > 0) { a_predictor.setMedianWindow(a_parameters.m_medianWindow); }
+}
+
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, RunningAveragePredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+    a_predictor.setCycle(a_parameters.m_averageCycle);
+}
+
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, SavitzkyGolayPredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+}
+
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, AlphaBetaGammaPredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+    a_predictor.setMemory(a_parameters.m_trackerMemory);
+}
+
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, RlsArPredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+    a_predictor.setForgetting(a_parameters.m_rlsForgetting);
+}
+
+inline void applyPredictorParameters(const PredictorParameters& a_parameters, LearnedPredictor& a_predictor)
+{
+    a_predictor.setVelocityLimit(a_parameters.m_velocityLimit);
+    a_predictor.setStopThreshold(a_parameters.m_stopThreshold);
+}
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,328 @@
+//==============================================================================
+/*
+    PredictorSwitcher.h
+
+    Predictor that forwards to one of several variants and switches between
+    them at run time without a cold start.
+
+    A switch request starts a warm-up on a background thread: the requested
+    variant is reset and fed the live samples, which the haptic thread hands
+    over through a lock-free ring, until it has seen WARMUP samples and
+    caught up. The haptic thread then replays the few samples the warm-up
+    thread has not consumed yet and makes the variant active. Only the
+    active variant is updated by the haptic thread, so a switch costs the
+    haptic loop a replay of a couple of samples, which is measured.
+
+    Settings (parameters, options) are applied to a variant by a configure
+    function that only the haptic thread calls: to the active variant by
+    the caller whenever they change, and to the target by the switcher
+    before the warm-up thread resets it and again at the hand-over, each
+    time while no other thread touches the target.
+
+    Variants must not share state (an ensemble needs members of its own),
+    since a variant is updated by the warm-up thread while another one is
+    active. Samples lost because the ring was full restart the warm-up.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef PredictorSwitcherH
+#define PredictorSwitcherH
+//------------------------------------------------------------------------------
+#include "CostMeter.h"
+#include "MotionPredictor.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+//------------------------------------------------------------------------------
+
+class PredictorSwitcher : public MotionPredictor
+{
+public:
+
+    // applies the current settings to a variant (haptic thread)
+    typedef void (*Configure)(MotionPredictor* a_variant);
+
+    // maximum number of variants
+    static const int MAX_VARIANTS = 8;
+
+    // samples the haptic thread keeps for the replay at the end of a warm-up
+    static const int HISTORY = 64;
+
+    // a_warmupSamples: samples fed to a variant before it takes over
+    PredictorSwitcher(int a_warmupSamples = 500) : m_warmupSamples(a_warmupSamples)
+    {
+        m_numVariants = 0;
+        m_configure = NULL;
+        m_count = 0;
+        m_target = 0;
+        m_active.store(0);
+        m_requested.store(0);
+        m_state.store(STATE_IDLE);
+        m_warmedCount.store(0);
+        m_switches.store(0);
+        m_warmupTime.store(0.0);
+        m_running.store(false);
+    }
+
+    ~PredictorSwitcher() { stop(); }
+
+    // add a variant (not owned, must outlive the switcher); returns its index or -1 if full
+    int addVariant(MotionPredictor* a_predictor)
+    {
+        if (m_numVariants == MAX_VARIANTS) { return -1; }
+        m_variants[m_numVariants] = a_predictor;
+        return m_numVariants++;
+    }
+
+    // function applying the settings to a variant before it is warmed up and made active
+    void setConfigure(Configure a_configure) { m_configure = a_configure; }
+
+    int getNumVariants() const { return m_numVariants; }
+    MotionPredictor* getVariant(int a_index) const { return m_variants[a_index]; }
+
+    // index of the variant called a_name, -1 if none
+    int findVariant(const char* a_name) const
+    {
+        for (int v = 0; v < m_numVariants; v++)
+        {
+            if (strcmp(m_variants[v]->getName(), a_name) == 0) { return v; }
+        }
+        return -1;
+    }
+
+    // start and stop the warm-up thread
+    void start()
+    {
+        if (m_thread.joinable()) { return; }
+        m_running.store(true);
+        m_thread = std::thread(&PredictorSwitcher::warmup, this);
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable()) { return; }
+        m_running.store(false);
+        m_thread.join();
+    }
+
+
+    //--------------------------------------------------------------------------
+    // SWITCHING (any thread)
+    //--------------------------------------------------------------------------
+
+    // make a_index the active variant once it is warm; returns false if there is no such variant
+    bool requestSwitch(int a_index)
+    {
+        if (a_index < 0 || a_index >= m_numVariants) { return false; }
+        m_requested.store(a_index);
+        return true;
+    }
+
+    int getActive() const { return m_active.load(); }
+    int getRequested() const { return m_requested.load(); }
+
+    // true while a requested variant is being warmed up
+    bool isSwitching() const { return (m_requested.load() != m_active.load()); }
+
+    // completed switches, cost of the hand-over in the haptic loop and duration [s]
+    // of the last warm-up
+    unsigned long long getSwitches() const { return m_switches.load(); }
+    const CostMeter& getSwitchCost() const { return m_switchCost; }
+    double getWarmupTime() const { return m_warmupTime.load(); }
+
+
+    //--------------------------------------------------------------------------
+    // PREDICTION (haptic thread)
+    //--------------------------------------------------------------------------
+
+    virtual const char* getName() const { return m_variants[m_active.load()]->getName(); }
+
+    // reset the active variant; a running warm-up continues
+    virtual void reset() { m_variants[m_active.load()]->reset(); }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        m_variants[m_active.load()]->update(a_sample);
+        track(a_sample);
+    }
+
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        m_variants[m_active.load()]->predict(a_horizon, a_prediction);
+    }
+
+    // pass a sample to the warm-up without updating the active variant, for ticks where
+    // the caller drives a substitute instead (update() calls it)
+    void track(const MotionSample& a_sample)
+    {
+        Entry entry;
+        entry.m_count = ++m_count;
+        entry.m_sample = a_sample;
+        m_history[m_count % HISTORY] = entry;
+
+        int state = m_state.load();
+        if (state == STATE_WARMING)
+        {
+            m_samples.push(entry);
+        }
+        else if (state == STATE_PREPARING)
+        {
+            // the warm-up thread waits for the target to be configured
+            if (m_configure != NULL) { m_configure(m_variants[m_target]); }
+            m_state.store(STATE_PREPARED);
+        }
+        else if (state == STATE_READY)
+        {
+            handOver();
+        }
+    }
+
+private:
+
+    enum State
+    {
+        STATE_IDLE,             // warm-up thread may start a warm-up
+        STATE_PREPARING,        // target chosen, haptic thread configures it
+        STATE_PREPARED,         // target configured, warm-up thread resets it
+        STATE_WARMING,          // haptic thread feeds the ring
+        STATE_READY             // target caught up, haptic thread takes it over
+    };
+
+    struct Entry
+    {
+        unsigned long long m_count;
+        MotionSample m_sample;
+    };
+
+    // make the warmed-up target active (haptic thread)
+    void handOver()
+    {
+        double start = CostMeter::now();
+
+        // samples still in the ring, the current one included
+        unsigned long long first = m_warmedCount.load() + 1;
+        if (m_count - first + 1 > (unsigned long long)HISTORY)
+        {
+            // too far behind to replay: warm up again
+            m_state.store(STATE_IDLE);
+            return;
+        }
+
+        // settings changed during the warm-up apply from here on
+        MotionPredictor* target = m_variants[m_target];
+        if (m_configure != NULL) { m_configure(target); }
+        for (unsigned long long n = first; n <= m_count; n++)
+        {
+            target->update(m_history[n % HISTORY].m_sample);
+        }
+
+        m_active.store(m_target);
+        m_state.store(STATE_IDLE);
+        m_switches++;
+        m_switchCost.add(CostMeter::now() - start);
+    }
+
+    // warm-up thread
+    void warmup()
+    {
+        while (m_running.load())
+        {
+            int requested = m_requested.load();
+            if (m_state.load() != STATE_IDLE || requested == m_active.load())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            // have the haptic thread configure the target
+            double start = CostMeter::now();
+            m_target = requested;
+            m_state.store(STATE_PREPARING);
+            while (m_running.load() && m_state.load() == STATE_PREPARING)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            if (!m_running.load()) { break; }
+
+            // discard what is left of an earlier warm-up, then start feeding the target
+            Entry entry;
+            while (m_samples.pop(entry)) {}
+            unsigned long long dropped = m_samples.getDropped();
+            MotionPredictor* target = m_variants[requested];
+            target->reset();
+            m_state.store(STATE_WARMING);
+
+            int fed = 0;
+            bool ready = false;
+            while (m_running.load() && m_requested.load() == requested)
+            {
+                if (m_samples.getDropped() != dropped) { break; }
+
+                if (m_samples.pop(entry))
+                {
+                    target->update(entry.m_sample);
+                    m_warmedCount.store(entry.m_count);
+                    fed++;
+                }
+                else if (fed >= m_warmupSamples)
+                {
+                    ready = true;
+                    break;
+                }
+                else
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+
+            // the target is left alone from here on
+            if (ready)
+            {
+                m_warmupTime.store(CostMeter::now() - start);
+                m_state.store(STATE_READY);
+            }
+            else
+            {
+                m_state.store(STATE_IDLE);
+            }
+
+            // wait until the haptic thread has taken the target over (or sent it back)
+            while (m_running.load() && m_state.load() == STATE_READY)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    MotionPredictor* m_variants[MAX_VARIANTS];
+    int m_numVariants;
+    int m_warmupSamples;
+    Configure m_configure;
+
+    // haptic thread
+    unsigned long long m_count;
+    Entry m_history[HISTORY];
+    CostMeter m_switchCost;
+
+    // shared
+    std::atomic<int> m_active;
+    std::atomic<int> m_requested;
+    std::atomic<int> m_state;
+    std::atomic<unsigned long long> m_warmedCount;
+    std::atomic<unsigned long long> m_switches;
+    std::atomic<double> m_warmupTime;
+    SpscRing<Entry, 4096> m_samples;
+
+    // warm-up thread (read by the haptic thread in STATE_PREPARING and STATE_READY)
+    int m_target;
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
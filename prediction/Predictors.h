@@ -0,0 +1,354 @@
+//==============================================================================
+/*
+    Predictors.h
+
+    Predictors that extrapolate the latest position along an estimated
+    velocity:
+
+    ThresholdPredictor       device velocity, clamped per axis, spikes held
+                             back by a fixed or noise-adaptive jitter
+                             threshold (optionally Savitzky-Golay velocity
+                             and a median prefilter)
+    RunningAveragePredictor  clamped device velocity averaged over a cycle
+                             of 31 samples (adjustable)
+    SavitzkyGolayPredictor   velocity differentiated from the positions
+
+    All of them reset the prediction to the current position when the
+    velocity falls below a stop threshold.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef PredictorsH
+#define PredictorsH
+//------------------------------------------------------------------------------
+#include "AdaptiveThreshold.h"
+#include "LaneKernels.h"
+#include "MedianFilter.h"
+#include "MotionPredictor.h"
+#include "SavitzkyGolay.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// half width of the Savitzky-Golay window (window = 2 * half + 1 samples)
+const int SG_HALF_WINDOW = 7;
+
+// default per-axis velocity limit [m/s]
+const double DEFAULT_VELOCITY_LIMIT = .05;
+
+// default fixed jitter threshold [m/s] (x axis only)
+const double DEFAULT_JITTER_THRESHOLD = .009;
+
+// default fixed stop threshold [m/s] on the L1 velocity
+const double DEFAULT_STOP_THRESHOLD = .001;
+
+
+//------------------------------------------------------------------------------
+// LINEAR EXTRAPOLATION
+//------------------------------------------------------------------------------
+
+class LinearExtrapolationPredictor : public MotionPredictor
+{
+public:
+
+    // x/y/z of the device packed in lanes of the kernel scalar type
+    typedef LaneVector<PredictionScalar, LANES_PER_DEVICE> Lanes;
+
+    LinearExtrapolationPredictor()
+    {
+        double limits[3] = { DEFAULT_VELOCITY_LIMIT, DEFAULT_VELOCITY_LIMIT, DEFAULT_VELOCITY_LIMIT };
+        m_velocityLimit.load(limits);
+        m_stopThreshold = DEFAULT_STOP_THRESHOLD;
+        m_clampHits[0] = m_clampHits[1] = m_clampHits[2] = 0;
+        LinearExtrapolationPredictor::reset();
+    }
+
+    virtual void reset()
+    {
+        m_position.fill(0);
+        m_velocity.fill(0);
+        m_stopped = true;
+    }
+
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        m_position.store(a_prediction.m_position);
+        if (m_stopped)
+        {
+            a_prediction.m_velocity[0] = a_prediction.m_velocity[1] = a_prediction.m_velocity[2] = 0.0;
+            return;
+        }
+
+        Lanes predicted;
+        extrapolateLanes(m_position, m_velocity, (PredictionScalar)a_horizon, predicted);
+        predicted.store(a_prediction.m_position);
+        m_velocity.store(a_prediction.m_velocity);
+    }
+
+    // per-axis velocity limit [m/s]
+    void setVelocityLimit(const double a_limit[3]) { m_velocityLimit.load(a_limit); }
+
+    // L1 velocity [m/s] below which the prediction is reset to the position
+    void setStopThreshold(double a_threshold) { m_stopThreshold = a_threshold; }
+
+    // samples whose velocity was clamped on an axis (since construction)
+    unsigned long long getClampHits(int a_axis) const { return m_clampHits[a_axis]; }
+
+protected:
+
+    // clamp a velocity to the per-axis limit, counting the axes that hit it
+    void clampVelocity(Lanes& a_velocity)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            PredictionScalar v = a_velocity.m_value[i];
+            if (v > m_velocityLimit.m_value[i] || v < -m_velocityLimit.m_value[i]) { m_clampHits[i]++; }
+        }
+        clampLanes(a_velocity, m_velocityLimit);
+    }
+
+    Lanes m_velocityLimit;
+    double m_stopThreshold;
+    unsigned long long m_clampHits[3];
+
+    Lanes m_position;
+    Lanes m_velocity;
+    bool m_stopped;
+};
+
+
+//------------------------------------------------------------------------------
+// THRESHOLD
+//------------------------------------------------------------------------------
+
+class ThresholdPredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    ThresholdPredictor()
+    {
+        m_useSavitzkyGolay = false;
+        m_useAdaptiveThreshold = false;
+        m_jitterRejections[0] = m_jitterRejections[1] = m_jitterRejections[2] = 0;
+        setJitterThreshold(DEFAULT_JITTER_THRESHOLD);
+        ThresholdPredictor::reset();
+    }
+
+    virtual const char* getName() const { return "threshold"; }
+
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        m_prevVelocity.fill(0);
+        m_differentiator.reset();
+        m_median.reset();
+        m_adaptiveThreshold.reset();
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        m_position.load(a_sample.m_position);
+
+        // differentiate the position stream (smooth velocity and acceleration)
+        m_differentiator.push(a_sample.m_time, m_position);
+
+        Lanes current;
+        current.load(a_sample.m_velocity);
+        if (m_useSavitzkyGolay && m_differentiator.isReady())
+        {
+            m_differentiator.getLatestVelocity(current);
+        }
+
+        // median of the last few velocities removes isolated spikes but follows steps
+        m_median.filter(current);
+
+        clampVelocity(current);
+
+        double clamped[3], previous[3];
+        current.store(clamped);
+        m_prevVelocity.store(previous);
+
+        // classify each axis against the noise estimate (keeps the estimate warm in all modes)
+        double flags[3];
+        for (int i = 0; i < 3; i++)
+        {
+            flags[i] = m_adaptiveThreshold.isJitter(i, clamped[i] - previous[i]) ? 1.0 : 0.0;
+        }
+
+        // discard linear velocity as jitter based on threshold value
+        // (the Savitzky-Golay estimate is already smooth and the median already free of
+        // spikes, neither needs spike rejection)
+        Lanes jitter;
+        if (m_useSavitzkyGolay || m_median.getWindow() > 1)
+        {
+            jitter.fill(0);
+        }
+        else if (m_useAdaptiveThreshold)
+        {
+            // hold only the axes whose change exceeds their own threshold
+            jitter.load(flags);
+        }
+        else
+        {
+            // hold the whole vector when the x axis jumps
+            jitterMaskLanes(current, m_prevVelocity, m_jitterThreshold, jitter);
+            spreadMaskLanes(jitter);
+        }
+
+        selectLanes(jitter, m_prevVelocity, current, m_velocity);
+        m_prevVelocity = m_velocity;
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (jitter.m_value[i] != 0) { m_jitterRejections[i]++; }
+        }
+
+        // reset predict location if velocity low
+        double speed = (double)l1NormLanes(current);
+        m_stopped = m_useAdaptiveThreshold ? m_adaptiveThreshold.isStopped(speed) : (speed < m_stopThreshold);
+    }
+
+    // fixed jitter threshold [m/s], applied to the x axis
+    void setJitterThreshold(double a_threshold)
+    {
+        double thresholds[3] = { a_threshold, HUGE_VAL, HUGE_VAL };
+        m_jitterThreshold.load(thresholds);
+    }
+
+    // velocity source: device (false) or Savitzky-Golay differentiated positions (true)
+    void setUseSavitzkyGolay(bool a_enabled) { m_useSavitzkyGolay = a_enabled; }
+    bool getUseSavitzkyGolay() const { return m_useSavitzkyGolay; }
+
+    // median prefilter window ahead of the clamp: 1 (off), 3, 5 or 7 samples; replaces
+    // the jitter threshold while on
+    void setMedianWindow(int a_window) { m_median.setWindow(a_window); }
+    int getMedianWindow() const { return m_median.getWindow(); }
+
+    // thresholds: fixed (false) or noise-adaptive per axis (true)
+    void setUseAdaptiveThreshold(bool a_enabled) { m_useAdaptiveThreshold = a_enabled; }
+    bool getUseAdaptiveThreshold() const { return m_useAdaptiveThreshold; }
+
+    // online noise estimate behind the adaptive thresholds
+    const AdaptiveJitterThreshold& getAdaptiveThreshold() const { return m_adaptiveThreshold; }
+
+    // lag [s] of the centred Savitzky-Golay estimate
+    double getSavitzkyGolayLag() const { return m_differentiator.getLagSeconds(); }
+
+    // samples whose velocity change on an axis was held back as jitter (since construction)
+    unsigned long long getJitterRejections(int a_axis) const { return m_jitterRejections[a_axis]; }
+
+private:
+
+    bool m_useSavitzkyGolay;
+    bool m_useAdaptiveThreshold;
+    unsigned long long m_jitterRejections[3];
+
+    Lanes m_jitterThreshold;
+    Lanes m_prevVelocity;
+
+    SavitzkyGolayDifferentiator<SG_HALF_WINDOW, PredictionScalar> m_differentiator;
+    MedianFilter<PredictionScalar, LANES_PER_DEVICE> m_median;
+    AdaptiveJitterThreshold m_adaptiveThreshold;
+};
+
+
+//------------------------------------------------------------------------------
+// RUNNING AVERAGE
+//------------------------------------------------------------------------------
+
+class RunningAveragePredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    // default number of samples in one averaging cycle
+    static const int CYCLE = 31;
+
+    RunningAveragePredictor()
+    {
+        m_cycle = CYCLE;
+        RunningAveragePredictor::reset();
+    }
+
+    virtual const char* getName() const { return "running average"; }
+
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        m_operand = 0;
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        m_position.load(a_sample.m_position);
+
+        Lanes current;
+        current.load(a_sample.m_velocity);
+        clampVelocity(current);
+
+        // avg = (avg * operand + current) / (operand + 1), operand cycling like the running average program
+        PredictionScalar weight = (PredictionScalar)1 / (PredictionScalar)(m_operand + 1);
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            m_velocity.m_value[i] += weight * (current.m_value[i] - m_velocity.m_value[i]);
+        }
+        m_operand = (m_operand + 1 >= m_cycle) ? 1 : m_operand + 1;
+
+        m_stopped = ((double)l1NormLanes(current) < m_stopThreshold);
+    }
+
+    // samples in one averaging cycle (at least 2), applied from the next sample
+    void setCycle(int a_cycle) { m_cycle = (a_cycle < 2) ? 2 : a_cycle; }
+    int getCycle() const { return m_cycle; }
+
+private:
+
+    int m_cycle;
+    int m_operand;
+};
+
+
+//------------------------------------------------------------------------------
+// SAVITZKY-GOLAY
+//------------------------------------------------------------------------------
+
+class SavitzkyGolayPredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    SavitzkyGolayPredictor()
+    {
+        SavitzkyGolayPredictor::reset();
+    }
+
+    virtual const char* getName() const { return "savitzky-golay"; }
+
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        m_differentiator.reset();
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        m_position.load(a_sample.m_position);
+        m_differentiator.push(a_sample.m_time, m_position);
+
+        if (!m_differentiator.isReady())
+        {
+            m_stopped = true;
+            return;
+        }
+
+        m_differentiator.getLatestVelocity(m_velocity);
+        clampVelocity(m_velocity);
+        m_stopped = ((double)l1NormLanes(m_velocity) < m_stopThreshold);
+    }
+
+private:
+
+    SavitzkyGolayDifferentiator<SG_HALF_WINDOW, PredictionScalar> m_differentiator;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
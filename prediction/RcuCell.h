@@ -0,0 +1,121 @@
+//==============================================================================
+/*
+    RcuCell.h
+
+    Pointer to an immutable object that one thread replaces while a single
+    real-time thread keeps reading it, in the manner of read-copy-update
+    with quiescent-state based reclamation.
+
+    The reader loads the pointer with one atomic load and never blocks or
+    writes shared memory except to announce a quiescent state (a point,
+    such as the end of a haptic tick, where it holds no pointer from the
+    cell). The writer builds a complete new object, swaps it in with an
+    atomic exchange and retires the old one; a retired object is deleted
+    only once the reader has announced a quiescent state after the swap, so
+    the reader can never see a half-updated or freed object.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef RcuCellH
+#define RcuCellH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <mutex>
+#include <vector>
+//------------------------------------------------------------------------------
+
+template <typename T>
+class RcuCell
+{
+public:
+
+    // a_initial: first object, owned by the cell
+    RcuCell(T* a_initial)
+    {
+        m_current.store(a_initial);
+        m_epoch.store(0);
+        m_readerEpoch.store(0);
+    }
+
+    ~RcuCell()
+    {
+        delete m_current.load();
+        for (size_t n = 0; n < m_retired.size(); n++)
+        {
+            delete m_retired[n].m_object;
+        }
+    }
+
+    // current object, valid until the reader's next quiescent state (reader thread)
+    const T* read() const { return m_current.load(); }
+
+    // number of objects published so far; read it before read(), so that the object
+    // is at least as new as the version (any thread)
+    unsigned long long getVersion() const { return m_epoch.load(); }
+
+    // announce that the reader holds no object from this cell (reader thread, wait-free)
+    void quiescent() { m_readerEpoch.store(m_epoch.load()); }
+
+    // replace the object, which the cell now owns, and free retired objects the reader
+    // is done with (writer threads)
+    void publish(T* a_object)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Retired retired;
+        retired.m_object = m_current.exchange(a_object);
+        retired.m_epoch = m_epoch.fetch_add(1) + 1;
+        m_retired.push_back(retired);
+
+        reclaim();
+    }
+
+    // free retired objects the reader is done with (writer threads)
+    void collect()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        reclaim();
+    }
+
+    // objects waiting for a quiescent state of the reader
+    size_t getRetired() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_retired.size();
+    }
+
+private:
+
+    struct Retired
+    {
+        T* m_object;
+        unsigned long long m_epoch;
+    };
+
+    // an object retired at epoch e is unreachable once the reader has seen epoch e
+    // at a quiescent state: every later read returns a newer object
+    void reclaim()
+    {
+        unsigned long long seen = m_readerEpoch.load();
+        size_t kept = 0;
+        for (size_t n = 0; n < m_retired.size(); n++)
+        {
+            if (m_retired[n].m_epoch <= seen) { delete m_retired[n].m_object; }
+            else { m_retired[kept++] = m_retired[n]; }
+        }
+        m_retired.resize(kept);
+    }
+
+    std::atomic<T*> m_current;
+    std::atomic<unsigned long long> m_epoch;
+    std::atomic<unsigned long long> m_readerEpoch;
+
+    // writers only
+    mutable std::mutex m_mutex;
+    std::vector<Retired> m_retired;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,293 @@
+//==============================================================================
+/*
+    RlsArPredictor.h
+
+    Autoregressive predictor adapted online by recursive least squares.
+    On each axis the velocity v(n), averaged over the last RLS_STEP samples,
+    is modelled from the RLS_ORDER block velocities before it:
+
+        v(n) = a1 v(n - STEP) + a2 v(n - 2 STEP) + ... + aN v(n - N STEP)
+
+    Every sample refits the coefficients with exponential forgetting
+    (lambda, a memory of about 1 / (1 - lambda) samples), so the model
+    follows the current operator without offline training. A prediction
+    runs the model forward, block by block, to the horizon (or for
+    RLS_FORECAST_BLOCKS, holding the last velocity after that; the forecast
+    is a dependent chain and a longer one costs more than it gains) and
+    moves the position along the mean of the forecast velocities.
+
+    The update is the covariance form of RLS, kept stable in fixed size:
+    the covariance is updated as a symmetric matrix (upper triangle,
+    mirrored), its trace is bounded so it cannot wind up while the device
+    rests, and it is reinitialized if it ever stops being positive. The
+    regression runs in double on all lanes at once, in velocities scaled
+    by DEFAULT_VELOCITY_LIMIT; the forecast velocities are bounded at every
+    step, so an unstable fit cannot run away.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef RlsArPredictorH
+#define RlsArPredictorH
+//------------------------------------------------------------------------------
+#include "Predictors.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// model order and spacing of its lags [samples]
+const int RLS_ORDER = 4;
+const int RLS_STEP  = 10;
+
+// default forgetting factor (memory of about 1000 samples, 1 s at 1 kHz)
+const double DEFAULT_RLS_FORGETTING = .999;
+
+// initial covariance (diagonal) and bound of its trace, in scaled velocities
+const double RLS_INITIAL_COVARIANCE = 10.0;
+const double RLS_MAX_TRACE = 1000.0;
+
+// blocks forecast by the model (250 ms); longer horizons hold the last forecast velocity
+const int RLS_FORECAST_BLOCKS = 25;
+
+// bound of the forecast velocities, in velocity limits (only stops a runaway fit; the
+// mean velocity is clamped to the limit itself)
+const double RLS_FORECAST_BOUND = 4.0;
+
+//------------------------------------------------------------------------------
+
+class RlsArPredictor : public LinearExtrapolationPredictor
+{
+public:
+
+    typedef LaneVector<double, LANES_PER_DEVICE> Wide;
+
+    RlsArPredictor()
+    {
+        m_forgetting = DEFAULT_RLS_FORGETTING;
+        RlsArPredictor::reset();
+    }
+
+    virtual const char* getName() const { return "rls-ar"; }
+
+    // forget the samples and restart from a constant-velocity model
+    virtual void reset()
+    {
+        LinearExtrapolationPredictor::reset();
+        for (int k = 0; k < RLS_ORDER; k++)
+        {
+            m_coefficient[k].fill((k == 0) ? 1.0 : 0.0);
+            m_recent[k].fill(0.0);
+        }
+        resetCovariance();
+        m_blockPeriod = 0.0;
+        m_next = 0;
+        m_count = 0;
+    }
+
+    virtual void update(const MotionSample& a_sample)
+    {
+        // a repeated time stamp adds nothing
+        int newest = (m_next + RING - 1) % RING;
+        if (m_count > 0 && a_sample.m_time <= m_time[newest]) { return; }
+
+        m_position.load(a_sample.m_position);
+        m_ringPosition[m_next].load(a_sample.m_position);
+        m_time[m_next] = a_sample.m_time;
+        m_next = (m_next + 1) % RING;
+        m_count++;
+
+        if (m_count <= (unsigned long long)RLS_STEP)
+        {
+            m_stopped = true;
+            return;
+        }
+
+        // block velocities, newest first (older lags repeat the oldest one available)
+        Wide velocity[RLS_ORDER + 1];
+        int available = (int)((m_count - 1) / RLS_STEP);
+        for (int k = 0; k <= RLS_ORDER; k++)
+        {
+            blockVelocity((k < available) ? k : available - 1, velocity[k]);
+        }
+
+        if (available > RLS_ORDER) { adapt(velocity + 1, velocity[0]); }
+
+        for (int k = 0; k < RLS_ORDER; k++) { m_recent[k] = velocity[k]; }
+        newest = (m_next + RING - 1) % RING;
+        m_blockPeriod = m_time[newest] - m_time[(newest + RING - RLS_STEP) % RING];
+
+        for (int i = 0; i < LANES_PER_DEVICE; i++) { m_velocity.m_value[i] = (PredictionScalar)velocity[0].m_value[i]; }
+        clampVelocity(m_velocity);
+        m_stopped = ((double)l1NormLanes(m_velocity) < m_stopThreshold);
+    }
+
+    // position moved along the mean of the block velocities forecast up to the horizon
+    virtual void predict(double a_horizon, MotionPrediction& a_prediction) const
+    {
+        m_position.store(a_prediction.m_position);
+        if (m_stopped || m_blockPeriod <= 0.0)
+        {
+            a_prediction.m_velocity[0] = a_prediction.m_velocity[1] = a_prediction.m_velocity[2] = 0.0;
+            return;
+        }
+
+        int blocks = (int)std::floor(a_horizon / m_blockPeriod + 0.5);
+        if (blocks < 1) { blocks = 1; }
+        int forecast = (blocks < RLS_FORECAST_BLOCKS) ? blocks : RLS_FORECAST_BLOCKS;
+
+        // block velocities, newest first, shifted by one block per step
+        Wide history[RLS_ORDER];
+        for (int k = 0; k < RLS_ORDER; k++) { history[k] = m_recent[k]; }
+
+        Wide limit, sum, next;
+        for (int i = 0; i < LANES_PER_DEVICE; i++) { limit.m_value[i] = RLS_FORECAST_BOUND * (double)m_velocityLimit.m_value[i]; }
+        sum.fill(0.0);
+        for (int b = 0; b < forecast; b++)
+        {
+            next.fill(0.0);
+            for (int k = 0; k < RLS_ORDER; k++)
+            {
+                for (int i = 0; i < LANES_PER_DEVICE; i++) { next.m_value[i] += m_coefficient[k].m_value[i] * history[k].m_value[i]; }
+            }
+            clampLanes(next, limit);
+            for (int i = 0; i < LANES_PER_DEVICE; i++) { sum.m_value[i] += next.m_value[i]; }
+
+            for (int k = RLS_ORDER - 1; k > 0; k--) { history[k] = history[k - 1]; }
+            history[0] = next;
+        }
+
+        Lanes mean, end, predicted;
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            mean.m_value[i] = (PredictionScalar)((sum.m_value[i] + (blocks - forecast) * next.m_value[i]) / blocks);
+            end.m_value[i] = (PredictionScalar)next.m_value[i];
+        }
+        clampLanes(mean, m_velocityLimit);
+        clampLanes(end, m_velocityLimit);
+
+        extrapolateLanes(m_position, mean, (PredictionScalar)a_horizon, predicted);
+        predicted.store(a_prediction.m_position);
+        end.store(a_prediction.m_velocity);
+    }
+
+    // forgetting factor in (0, 1]: lower adapts faster, higher averages over more samples
+    void setForgetting(double a_forgetting) { m_forgetting = a_forgetting; }
+    double getForgetting() const { return m_forgetting; }
+
+    // current coefficient a(k + 1) of an axis
+    double getCoefficient(int a_axis, int a_k) const { return m_coefficient[a_k].m_value[a_axis]; }
+
+private:
+
+    static const int RING = (RLS_ORDER + 1) * RLS_STEP + 1;
+
+    // mean velocity over block a_lag (0 = the newest RLS_STEP samples)
+    void blockVelocity(int a_lag, Wide& a_velocity) const
+    {
+        int later = (m_next + RING - 1 - a_lag * RLS_STEP) % RING;
+        int earlier = (later + RING - RLS_STEP) % RING;
+        double rate = 1.0 / (m_time[later] - m_time[earlier]);
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            a_velocity.m_value[i] = (m_ringPosition[later].m_value[i] - m_ringPosition[earlier].m_value[i]) * rate;
+        }
+    }
+
+    // one RLS step on regressors a_lags (newest first) and observation a_velocity
+    void adapt(const Wide* a_lags, const Wide& a_velocity)
+    {
+        const double scale = 1.0 / DEFAULT_VELOCITY_LIMIT;
+        double inverseForgetting = 1.0 / m_forgetting;
+
+        Wide x[RLS_ORDER], px[RLS_ORDER];
+        Wide residual, denominator;
+        residual.fill(0.0);
+        denominator.fill(m_forgetting);
+        for (int k = 0; k < RLS_ORDER; k++)
+        {
+            for (int i = 0; i < LANES_PER_DEVICE; i++) { x[k].m_value[i] = a_lags[k].m_value[i] * scale; }
+        }
+
+        // P x, lambda + x' P x and the a priori residual
+        for (int r = 0; r < RLS_ORDER; r++)
+        {
+            px[r].fill(0.0);
+            for (int c = 0; c < RLS_ORDER; c++)
+            {
+                for (int i = 0; i < LANES_PER_DEVICE; i++) { px[r].m_value[i] += m_covariance[r][c].m_value[i] * x[c].m_value[i]; }
+            }
+            for (int i = 0; i < LANES_PER_DEVICE; i++)
+            {
+                denominator.m_value[i] += x[r].m_value[i] * px[r].m_value[i];
+                residual.m_value[i] -= m_coefficient[r].m_value[i] * x[r].m_value[i];
+            }
+        }
+        for (int i = 0; i < LANES_PER_DEVICE; i++) { residual.m_value[i] += a_velocity.m_value[i] * scale; }
+
+        // a covariance that lost positiveness (rounding) starts over
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            if (!(denominator.m_value[i] >= m_forgetting)) { resetCovariance(); return; }
+        }
+
+        // gain k = P x / denominator, coefficients and symmetric covariance update
+        Wide gain[RLS_ORDER];
+        for (int r = 0; r < RLS_ORDER; r++)
+        {
+            for (int i = 0; i < LANES_PER_DEVICE; i++)
+            {
+                gain[r].m_value[i] = px[r].m_value[i] / denominator.m_value[i];
+                m_coefficient[r].m_value[i] += gain[r].m_value[i] * residual.m_value[i];
+            }
+        }
+
+        Wide trace;
+        trace.fill(0.0);
+        for (int r = 0; r < RLS_ORDER; r++)
+        {
+            for (int c = r; c < RLS_ORDER; c++)
+            {
+                for (int i = 0; i < LANES_PER_DEVICE; i++)
+                {
+                    double p = (m_covariance[r][c].m_value[i] - gain[r].m_value[i] * px[c].m_value[i]) * inverseForgetting;
+                    m_covariance[r][c].m_value[i] = p;
+                    m_covariance[c][r].m_value[i] = p;
+                }
+            }
+            for (int i = 0; i < LANES_PER_DEVICE; i++) { trace.m_value[i] += m_covariance[r][r].m_value[i]; }
+        }
+
+        // bounded trace: without excitation P grows by 1 / lambda every sample
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            double shrink = (trace.m_value[i] > RLS_MAX_TRACE) ? RLS_MAX_TRACE / trace.m_value[i] : 1.0;
+            for (int r = 0; r < RLS_ORDER; r++)
+            {
+                for (int c = 0; c < RLS_ORDER; c++) { m_covariance[r][c].m_value[i] *= shrink; }
+            }
+        }
+    }
+
+    void resetCovariance()
+    {
+        for (int r = 0; r < RLS_ORDER; r++)
+        {
+            for (int c = 0; c < RLS_ORDER; c++) { m_covariance[r][c].fill((r == c) ? RLS_INITIAL_COVARIANCE : 0.0); }
+        }
+    }
+
+    double m_forgetting;
+
+    Wide m_coefficient[RLS_ORDER];
+    Wide m_covariance[RLS_ORDER][RLS_ORDER];
+    Wide m_recent[RLS_ORDER];               // block velocities, newest first
+    double m_blockPeriod;                   // duration of the newest block [s]
+
+    Wide m_ringPosition[RING];
+    double m_time[RING];
+    int m_next;
+    unsigned long long m_count;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,199 @@
+//==============================================================================
+/*
+    SavitzkyGolay.h
+
+    Savitzky-Golay differentiator that estimates velocity and acceleration
+    of the haptic device directly from its position stream.
+
+    A quadratic polynomial is least-squares fitted over the last 2m+1
+    positions. Its derivatives reduce to fixed convolution weights, so every
+    tick costs exactly 2m+1 multiply-adds per derivative, applied to x, y and
+    z together in one lane vector.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef SavitzkyGolayH
+#define SavitzkyGolayH
+//------------------------------------------------------------------------------
+#include "LaneKernels.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// COEFFICIENTS
+//------------------------------------------------------------------------------
+
+// first derivative weight of sample k (k = -m..m) at the centre of the window
+inline constexpr double sgVelocityWeight(int k, int m)
+{
+    return (3.0 * k) / (m * (m + 1.0) * (2.0 * m + 1.0));
+}
+
+// second derivative weight of sample k (k = -m..m), constant over the window
+inline constexpr double sgAccelerationWeight(int k, int m)
+{
+    return (30.0 * (3.0 * k * k - m * (m + 1.0))) /
+           (m * (m + 1.0) * (2.0 * m + 1.0) * (2.0 * m - 1.0) * (2.0 * m + 3.0));
+}
+
+// first derivative weight of sample k evaluated at the newest sample (k = m)
+inline constexpr double sgLatestVelocityWeight(int k, int m)
+{
+    return sgVelocityWeight(k, m) + m * sgAccelerationWeight(k, m);
+}
+
+// over 3 samples the weights reduce to the central differences
+static_assert(sgVelocityWeight(1, 1) == 0.5, "unexpected Savitzky-Golay velocity weight");
+static_assert(sgAccelerationWeight(0, 1) == -2.0, "unexpected Savitzky-Golay acceleration weight");
+
+
+//------------------------------------------------------------------------------
+// DIFFERENTIATOR
+//------------------------------------------------------------------------------
+
+template <int HALF_WINDOW, typename T = double>
+class SavitzkyGolayDifferentiator
+{
+    static_assert(HALF_WINDOW >= 1, "Savitzky-Golay window needs at least 3 samples");
+
+public:
+
+    // number of position samples in the fitting window
+    static const int WINDOW = 2 * HALF_WINDOW + 1;
+
+    // x/y/z of one sample packed in lanes
+    typedef LaneVector<T, LANES_PER_DEVICE> Lanes;
+
+    SavitzkyGolayDifferentiator()
+    {
+        for (int j = 0; j < WINDOW; j++)
+        {
+            m_velocityWeight[j]       = (T)sgVelocityWeight(j - HALF_WINDOW, HALF_WINDOW);
+            m_latestVelocityWeight[j] = (T)sgLatestVelocityWeight(j - HALF_WINDOW, HALF_WINDOW);
+            m_accelerationWeight[j]   = (T)sgAccelerationWeight(j - HALF_WINDOW, HALF_WINDOW);
+        }
+        reset();
+    }
+
+    // discard all stored samples
+    void reset()
+    {
+        m_head = 0;
+        m_count = 0;
+        for (int j = 0; j < 2 * WINDOW; j++)
+        {
+            m_time[j] = 0.0;
+            m_samples[j].fill((T)0);
+        }
+    }
+
+    // append a position sample [m] taken at a_time [s]
+    void push(double a_time, const double a_position[3])
+    {
+        Lanes sample;
+        sample.load(a_position);
+        push(a_time, sample);
+    }
+
+    // append a position sample [m] already packed in lanes
+    void push(double a_time, const Lanes& a_position)
+    {
+        // every sample is stored twice so the window is always contiguous
+        int mirror = m_head + WINDOW;
+        m_time[m_head] = m_time[mirror] = a_time;
+        m_samples[m_head] = m_samples[mirror] = a_position;
+
+        m_head = (m_head + 1 == WINDOW) ? 0 : m_head + 1;
+        if (m_count < WINDOW) { m_count++; }
+    }
+
+    // true once the window has been filled
+    bool isReady() const { return (m_count == WINDOW); }
+
+    // average sample period [s] over the window (timestamps are kept in double)
+    double getSamplePeriod() const
+    {
+        double span = m_time[m_head + WINDOW - 1] - m_time[m_head];
+        return (span > 0.0) ? span / (WINDOW - 1) : 0.0;
+    }
+
+    // delay [s] of the centred estimates relative to the newest sample
+    double getLagSeconds() const { return HALF_WINDOW * getSamplePeriod(); }
+
+    // velocity [m/s] at the centre of the window (smooth, delayed by getLagSeconds())
+    void getVelocity(double a_velocity[3]) const
+    {
+        Lanes result;
+        getVelocity(result);
+        result.store(a_velocity);
+    }
+
+    void getVelocity(Lanes& a_velocity) const
+    {
+        double period = getSamplePeriod();
+        convolve(m_velocityWeight, (period > 0.0) ? (T)(1.0 / period) : (T)0, a_velocity);
+    }
+
+    // velocity [m/s] of the fitted polynomial at the newest sample (no lag, noisier)
+    void getLatestVelocity(double a_velocity[3]) const
+    {
+        Lanes result;
+        getLatestVelocity(result);
+        result.store(a_velocity);
+    }
+
+    void getLatestVelocity(Lanes& a_velocity) const
+    {
+        double period = getSamplePeriod();
+        convolve(m_latestVelocityWeight, (period > 0.0) ? (T)(1.0 / period) : (T)0, a_velocity);
+    }
+
+    // acceleration [m/s^2] of the fitted polynomial
+    void getAcceleration(double a_acceleration[3]) const
+    {
+        Lanes result;
+        getAcceleration(result);
+        result.store(a_acceleration);
+    }
+
+    void getAcceleration(Lanes& a_acceleration) const
+    {
+        double period = getSamplePeriod();
+        convolve(m_accelerationWeight, (period > 0.0) ? (T)(1.0 / (period * period)) : (T)0, a_acceleration);
+    }
+
+private:
+
+    // weighted sum over the window (all axes at once), scaled by the sample period factor
+    void convolve(const T* a_weight, T a_scale, Lanes& a_result) const
+    {
+        Lanes sum;
+        sum.fill((T)0);
+        const Lanes* window = &m_samples[m_head];
+        for (int j = 0; j < WINDOW; j++)
+        {
+            for (int i = 0; i < LANES_PER_DEVICE; i++)
+            {
+                sum.m_value[i] += a_weight[j] * window[j].m_value[i];
+            }
+        }
+        for (int i = 0; i < LANES_PER_DEVICE; i++)
+        {
+            a_result.m_value[i] = a_scale * sum.m_value[i];
+        }
+    }
+
+    T m_velocityWeight[WINDOW];
+    T m_latestVelocityWeight[WINDOW];
+    T m_accelerationWeight[WINDOW];
+
+    double m_time[2 * WINDOW];
+    Lanes m_samples[2 * WINDOW];
+
+    int m_head;
+    int m_count;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
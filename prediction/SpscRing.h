@@ -0,0 +1,80 @@
+//==============================================================================
+/*
+    SpscRing.h
+
+    Lock-free single producer / single consumer ring of fixed capacity.
+
+    Used to hand samples from the haptic thread to a slower consumer (trace
+    writer, display) without locks or allocation. Pushing never blocks: when
+    the ring is full the sample is rejected and counted, so the haptic loop
+    keeps its timing. Head and tail live on separate cache lines.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef SpscRingH
+#define SpscRingH
+//------------------------------------------------------------------------------
+#include <atomic>
+//------------------------------------------------------------------------------
+
+template <typename T, int CAPACITY>
+class SpscRing
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+
+    SpscRing()
+    {
+        m_head.store(0);
+        m_tail.store(0);
+        m_dropped.store(0);
+    }
+
+    // append an element, returns false (and counts a drop) if full (producer thread)
+    bool push(const T& a_value)
+    {
+        unsigned long long head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+        {
+            m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_buffer[head & (CAPACITY - 1)] = a_value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // remove the oldest element, returns false if empty (consumer thread)
+    bool pop(T& a_value)
+    {
+        unsigned long long tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) { return false; }
+
+        a_value = m_buffer[tail & (CAPACITY - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // number of elements waiting (approximate from other threads)
+    int getSize() const
+    {
+        return (int)(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+
+    // number of elements rejected because the ring was full
+    unsigned long long getDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+
+    alignas(64) std::atomic<unsigned long long> m_head;
+    std::atomic<unsigned long long> m_dropped;
+    alignas(64) std::atomic<unsigned long long> m_tail;
+    alignas(64) T m_buffer[CAPACITY];
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
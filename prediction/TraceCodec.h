@@ -0,0 +1,390 @@
+//==============================================================================
+/*
+    TraceCodec.h
+
+    Compact encoding of recorded device samples.
+
+    Every field is quantized to a fixed step below the resolution of the
+    device, so a sample becomes a set of integers. Consecutive samples are
+    encoded as differences (second differences for the timestamp, which
+    advances at a nearly constant rate, XOR for the buttons), zigzag mapped
+    to unsigned and written as LEB128 varints. At 1 kHz most differences
+    fit in one or two bytes, so a sample of 144 bytes shrinks to roughly
+    25 bytes.
+
+    Samples are grouped in chunks; the encoder and decoder state is reset at
+    the start of each chunk so chunks decode independently.
+
+    File layout (all integers and doubles little endian):
+        TRACE_MAGIC
+        chunks:   uint32 sample count, uint32 payload bytes, payload
+        index:    one TraceChunkInfo record per chunk
+        trailer:  uint64 index offset, uint32 chunk count, TRACE_INDEX_MAGIC
+    The index gives the time range, offset and summary statistics of every
+    chunk, so readers can seek by time in O(log n) and skip chunks without
+    events. A file without trailer (recording interrupted) is still
+    readable; its index is rebuilt by scanning the chunks.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef TraceCodecH
+#define TraceCodecH
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// SAMPLE
+//------------------------------------------------------------------------------
+
+// one recorded device sample
+struct TraceSample
+{
+    double m_time;              // [s]
+    double m_position[3];       // [m]
+    double m_velocity[3];       // [m/s]
+    double m_rotation[9];       // row major
+    double m_gripperAngle;      // [rad]
+    unsigned int m_buttons;     // bit n = user switch n
+};
+
+// quantized scalar fields of a sample: time, position, velocity, rotation, gripper
+const int TRACE_FIELDS = 17;
+
+static_assert(offsetof(TraceSample, m_gripperAngle) == (TRACE_FIELDS - 1) * sizeof(double),
+              "scalar fields of TraceSample must be contiguous");
+
+// quantization steps of the fields (position well below the 0.055 mm of the Touch)
+const double TRACE_TIME_STEP     = 1e-6;     // [s]
+const double TRACE_POSITION_STEP = 1e-5;     // [m]
+const double TRACE_VELOCITY_STEP = 1e-4;     // [m/s]
+const double TRACE_ROTATION_STEP = 1e-4;     // matrix element
+const double TRACE_GRIPPER_STEP  = 1e-4;     // [rad]
+
+// samples per chunk
+const int TRACE_CHUNK_SAMPLES = 1024;
+
+// upper bound of the encoded size of one sample [bytes] (10 byte varint per field, 5 for buttons)
+const int TRACE_MAX_SAMPLE_BYTES = TRACE_FIELDS * 10 + 5;
+
+// size of the chunk header [bytes]
+const int TRACE_CHUNK_HEADER_BYTES = 8;
+
+// file signature (8 bytes, last characters are the format version)
+const char TRACE_MAGIC[9] = "GTPTRC02";
+
+// signature closing the trailer
+const char TRACE_INDEX_MAGIC[9] = "GTPTRIDX";
+
+// size of one index record and of the trailer [bytes]
+const int TRACE_INDEX_RECORD_BYTES = 48;
+const int TRACE_TRAILER_BYTES = 20;
+
+
+//------------------------------------------------------------------------------
+// CHUNK INDEX
+//------------------------------------------------------------------------------
+
+// location and summary of one chunk
+struct TraceChunkInfo
+{
+    unsigned long long m_offset;    // file offset of the chunk header [bytes]
+    unsigned int m_count;           // samples
+    unsigned int m_buttonEvents;    // samples whose buttons differ from the previous sample
+    double m_startTime;             // time of the first sample [s]
+    double m_endTime;               // time of the last sample [s]
+    double m_minSpeed;              // smallest and largest velocity magnitude [m/s]
+    double m_maxSpeed;
+};
+
+// fold a sample into the summary of the chunk being written
+// (a_previousButtons: buttons of the sample before, in this or the previous chunk)
+inline void traceAccumulate(TraceChunkInfo& a_info, const TraceSample& a_sample, unsigned int a_previousButtons)
+{
+    const double* v = a_sample.m_velocity;
+    double speed = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+    if (a_info.m_count == 0)
+    {
+        a_info.m_startTime = a_sample.m_time;
+        a_info.m_minSpeed = speed;
+        a_info.m_maxSpeed = speed;
+    }
+    if (speed < a_info.m_minSpeed) { a_info.m_minSpeed = speed; }
+    if (speed > a_info.m_maxSpeed) { a_info.m_maxSpeed = speed; }
+    if (a_sample.m_buttons != a_previousButtons) { a_info.m_buttonEvents++; }
+
+    a_info.m_endTime = a_sample.m_time;
+    a_info.m_count++;
+}
+
+
+//------------------------------------------------------------------------------
+// PRIMITIVES
+//------------------------------------------------------------------------------
+
+inline unsigned long long traceZigzag(long long a_value)
+{
+    return ((unsigned long long)a_value << 1) ^ (unsigned long long)(a_value >> 63);
+}
+
+inline long long traceUnzigzag(unsigned long long a_value)
+{
+    return (long long)(a_value >> 1) ^ -(long long)(a_value & 1);
+}
+
+// write a LEB128 varint, returns the number of bytes written
+inline int traceWriteVarint(unsigned long long a_value, unsigned char* a_out)
+{
+    int n = 0;
+    while (a_value >= 0x80)
+    {
+        a_out[n++] = (unsigned char)(a_value | 0x80);
+        a_value >>= 7;
+    }
+    a_out[n++] = (unsigned char)a_value;
+    return n;
+}
+
+// read a LEB128 varint, returns the position after it or NULL if truncated
+inline const unsigned char* traceReadVarint(const unsigned char* a_in, const unsigned char* a_end, unsigned long long& a_value)
+{
+    // fast path: one byte
+    if (a_in < a_end && *a_in < 0x80)
+    {
+        a_value = *a_in;
+        return a_in + 1;
+    }
+
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64 && a_in < a_end; shift += 7)
+    {
+        unsigned char byte = *a_in++;
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            a_value = value;
+            return a_in;
+        }
+    }
+    return NULL;
+}
+
+inline void traceWriteUint32(unsigned int a_value, unsigned char* a_out)
+{
+    a_out[0] = (unsigned char)(a_value);
+    a_out[1] = (unsigned char)(a_value >> 8);
+    a_out[2] = (unsigned char)(a_value >> 16);
+    a_out[3] = (unsigned char)(a_value >> 24);
+}
+
+inline unsigned int traceReadUint32(const unsigned char* a_in)
+{
+    return (unsigned int)a_in[0] | ((unsigned int)a_in[1] << 8) |
+           ((unsigned int)a_in[2] << 16) | ((unsigned int)a_in[3] << 24);
+}
+
+inline void traceWriteUint64(unsigned long long a_value, unsigned char* a_out)
+{
+    traceWriteUint32((unsigned int)a_value, a_out);
+    traceWriteUint32((unsigned int)(a_value >> 32), a_out + 4);
+}
+
+inline unsigned long long traceReadUint64(const unsigned char* a_in)
+{
+    return (unsigned long long)traceReadUint32(a_in) | ((unsigned long long)traceReadUint32(a_in + 4) << 32);
+}
+
+inline void traceWriteDouble(double a_value, unsigned char* a_out)
+{
+    unsigned long long bits;
+    memcpy(&bits, &a_value, sizeof(bits));
+    traceWriteUint64(bits, a_out);
+}
+
+inline double traceReadDouble(const unsigned char* a_in)
+{
+    unsigned long long bits = traceReadUint64(a_in);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// serialize an index record (TRACE_INDEX_RECORD_BYTES)
+inline void traceWriteChunkInfo(const TraceChunkInfo& a_info, unsigned char* a_out)
+{
+    traceWriteUint64(a_info.m_offset, a_out);
+    traceWriteUint32(a_info.m_count, a_out + 8);
+    traceWriteUint32(a_info.m_buttonEvents, a_out + 12);
+    traceWriteDouble(a_info.m_startTime, a_out + 16);
+    traceWriteDouble(a_info.m_endTime, a_out + 24);
+    traceWriteDouble(a_info.m_minSpeed, a_out + 32);
+    traceWriteDouble(a_info.m_maxSpeed, a_out + 40);
+}
+
+inline TraceChunkInfo traceReadChunkInfo(const unsigned char* a_in)
+{
+    TraceChunkInfo info;
+    info.m_offset = traceReadUint64(a_in);
+    info.m_count = traceReadUint32(a_in + 8);
+    info.m_buttonEvents = traceReadUint32(a_in + 12);
+    info.m_startTime = traceReadDouble(a_in + 16);
+    info.m_endTime = traceReadDouble(a_in + 24);
+    info.m_minSpeed = traceReadDouble(a_in + 32);
+    info.m_maxSpeed = traceReadDouble(a_in + 40);
+    return info;
+}
+
+
+//------------------------------------------------------------------------------
+// FIELD ACCESS
+//------------------------------------------------------------------------------
+
+// quantization step of each field
+inline const double* traceFieldSteps()
+{
+    static const double steps[TRACE_FIELDS] =
+    {
+        TRACE_TIME_STEP,
+        TRACE_POSITION_STEP, TRACE_POSITION_STEP, TRACE_POSITION_STEP,
+        TRACE_VELOCITY_STEP, TRACE_VELOCITY_STEP, TRACE_VELOCITY_STEP,
+        TRACE_ROTATION_STEP, TRACE_ROTATION_STEP, TRACE_ROTATION_STEP,
+        TRACE_ROTATION_STEP, TRACE_ROTATION_STEP, TRACE_ROTATION_STEP,
+        TRACE_ROTATION_STEP, TRACE_ROTATION_STEP, TRACE_ROTATION_STEP,
+        TRACE_GRIPPER_STEP
+    };
+    return steps;
+}
+
+// the scalar fields of a sample are laid out contiguously from m_time to m_gripperAngle
+inline const double* traceFields(const TraceSample& a_sample) { return &a_sample.m_time; }
+inline double* traceFields(TraceSample& a_sample) { return &a_sample.m_time; }
+
+
+//------------------------------------------------------------------------------
+// ENCODER
+//------------------------------------------------------------------------------
+
+class TraceEncoder
+{
+public:
+
+    TraceEncoder() { reset(); }
+
+    // start a new chunk
+    void reset()
+    {
+        for (int i = 0; i < TRACE_FIELDS; i++) { m_previous[i] = 0; }
+        m_previousTimeDelta = 0;
+        m_previousButtons = 0;
+    }
+
+    // encode one sample into a_out (at least TRACE_MAX_SAMPLE_BYTES), returns the bytes written
+    int encode(const TraceSample& a_sample, unsigned char* a_out)
+    {
+        const double* steps = traceFieldSteps();
+        const double* fields = traceFields(a_sample);
+        int n = 0;
+
+        // timestamp: second difference
+        long long time = llround(fields[0] / steps[0]);
+        long long timeDelta = time - m_previous[0];
+        n += traceWriteVarint(traceZigzag(timeDelta - m_previousTimeDelta), a_out + n);
+        m_previous[0] = time;
+        m_previousTimeDelta = timeDelta;
+
+        // other fields: first difference
+        for (int i = 1; i < TRACE_FIELDS; i++)
+        {
+            long long value = llround(fields[i] / steps[i]);
+            n += traceWriteVarint(traceZigzag(value - m_previous[i]), a_out + n);
+            m_previous[i] = value;
+        }
+
+        // buttons: changed bits
+        n += traceWriteVarint(a_sample.m_buttons ^ m_previousButtons, a_out + n);
+        m_previousButtons = a_sample.m_buttons;
+
+        return n;
+    }
+
+private:
+
+    long long m_previous[TRACE_FIELDS];
+    long long m_previousTimeDelta;
+    unsigned int m_previousButtons;
+};
+
+
+//------------------------------------------------------------------------------
+// DECODER
+//------------------------------------------------------------------------------
+
+class TraceDecoder
+{
+public:
+
+    TraceDecoder() { reset(); }
+
+    // start a new chunk
+    void reset()
+    {
+        for (int i = 0; i < TRACE_FIELDS; i++) { m_previous[i] = 0; }
+        m_previousTimeDelta = 0;
+        m_previousButtons = 0;
+    }
+
+    // decode one sample, returns the position after it or NULL if the data is truncated
+    const unsigned char* decode(const unsigned char* a_in, const unsigned char* a_end, TraceSample& a_sample)
+    {
+        const double* steps = traceFieldSteps();
+        double* fields = traceFields(a_sample);
+        unsigned long long value;
+
+        a_in = traceReadVarint(a_in, a_end, value);
+        if (a_in == NULL) { return NULL; }
+        m_previousTimeDelta += traceUnzigzag(value);
+        m_previous[0] += m_previousTimeDelta;
+        fields[0] = (double)m_previous[0] * steps[0];
+
+        for (int i = 1; i < TRACE_FIELDS; i++)
+        {
+            a_in = traceReadVarint(a_in, a_end, value);
+            if (a_in == NULL) { return NULL; }
+            m_previous[i] += traceUnzigzag(value);
+            fields[i] = (double)m_previous[i] * steps[i];
+        }
+
+        a_in = traceReadVarint(a_in, a_end, value);
+        if (a_in == NULL) { return NULL; }
+        m_previousButtons ^= (unsigned int)value;
+        a_sample.m_buttons = m_previousButtons;
+
+        return a_in;
+    }
+
+    // decode a whole chunk payload of a_count samples, returns false if it is corrupt
+    bool decodeChunk(const unsigned char* a_in, const unsigned char* a_end, int a_count, TraceSample* a_samples)
+    {
+        reset();
+        for (int n = 0; n < a_count; n++)
+        {
+            a_in = decode(a_in, a_end, a_samples[n]);
+            if (a_in == NULL) { return false; }
+        }
+        return (a_in == a_end);
+    }
+
+private:
+
+    long long m_previous[TRACE_FIELDS];
+    long long m_previousTimeDelta;
+    unsigned int m_previousButtons;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
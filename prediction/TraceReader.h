@@ -0,0 +1,250 @@
+//==============================================================================
+/*
+    TraceReader.h
+
+    Reads trace files written by TraceWriter.
+
+    The chunk index is loaded when the file is opened, so any chunk can be
+    read directly: seeking to a time is a binary search over the chunk start
+    times followed by one chunk read, and analysis tools can select chunks
+    by their summary (speed range, button events) without decoding them.
+    A chunk is read with a single fread and decoded in one pass, so replay
+    is bound by the varint decoding loop rather than by I/O calls.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef TraceReaderH
+#define TraceReaderH
+//------------------------------------------------------------------------------
+#include "TraceCodec.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+//------------------------------------------------------------------------------
+
+class TraceReader
+{
+public:
+
+    TraceReader() : m_file(NULL), m_recovered(false), m_chunk(0), m_next(0) {}
+    ~TraceReader() { close(); }
+
+    // open a trace and load its index, returns false if the file is missing or not a trace
+    bool open(const char* a_filename)
+    {
+        close();
+
+        m_file = fopen(a_filename, "rb");
+        if (m_file == NULL) { return false; }
+
+        char magic[8];
+        if (fread(magic, 1, 8, m_file) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0)
+        {
+            close();
+            return false;
+        }
+
+        // an interrupted recording has no trailer: rebuild the index from the chunks
+        if (!loadIndex())
+        {
+            rebuildIndex();
+            m_recovered = true;
+        }
+
+        m_startTimes.resize(m_index.size());
+        for (size_t n = 0; n < m_index.size(); n++)
+        {
+            m_startTimes[n] = m_index[n].m_startTime;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (m_file != NULL) { fclose(m_file); }
+        m_file = NULL;
+        m_recovered = false;
+        m_index.clear();
+        m_startTimes.clear();
+        m_samples.clear();
+        m_chunk = 0;
+        m_next = 0;
+    }
+
+    // chunk index
+    int getNumChunks() const { return (int)m_index.size(); }
+    const TraceChunkInfo& getChunkInfo(int a_chunk) const { return m_index[a_chunk]; }
+
+    // true if the file had no index and it was rebuilt by scanning
+    bool isRecovered() const { return m_recovered; }
+
+    // chunk containing time a_time [s] (the first chunk before the trace, the last after it)
+    int findChunk(double a_time) const
+    {
+        if (m_index.empty()) { return -1; }
+        int chunk = (int)(std::upper_bound(m_startTimes.begin(), m_startTimes.end(), a_time) - m_startTimes.begin()) - 1;
+        return (chunk < 0) ? 0 : chunk;
+    }
+
+    // decode chunk a_chunk into a_samples, returns false on corrupt data
+    bool readChunk(int a_chunk, std::vector<TraceSample>& a_samples)
+    {
+        if (m_file == NULL || a_chunk < 0 || a_chunk >= (int)m_index.size()) { return false; }
+        if (!seekFile(m_index[a_chunk].m_offset)) { return false; }
+
+        unsigned int count, bytes;
+        if (!readChunkHeader(count, bytes) || count != m_index[a_chunk].m_count) { return false; }
+
+        m_payload.resize(bytes);
+        if (fread(m_payload.data(), 1, bytes, m_file) != bytes) { return false; }
+
+        a_samples.resize(count);
+        return m_decoder.decodeChunk(m_payload.data(), m_payload.data() + bytes, (int)count, a_samples.data());
+    }
+
+    // position the reader so next() returns the first sample at or after a_time [s]
+    bool seek(double a_time)
+    {
+        int chunk = findChunk(a_time);
+        if (chunk < 0 || !readChunk(chunk, m_samples)) { return false; }
+
+        m_chunk = chunk + 1;
+        m_next = 0;
+        while (m_next < m_samples.size() && m_samples[m_next].m_time < a_time) { m_next++; }
+        return true;
+    }
+
+    // rewind to the first sample
+    void rewind()
+    {
+        m_samples.clear();
+        m_chunk = 0;
+        m_next = 0;
+    }
+
+    // next sample of the trace, returns false at the end
+    bool next(TraceSample& a_sample)
+    {
+        while (m_next == m_samples.size())
+        {
+            m_next = 0;
+            if (!readChunk(m_chunk++, m_samples))
+            {
+                m_samples.clear();
+                return false;
+            }
+        }
+        a_sample = m_samples[m_next++];
+        return true;
+    }
+
+private:
+
+    bool seekFile(unsigned long long a_offset)
+    {
+#ifdef _WIN32
+        return (_fseeki64(m_file, (long long)a_offset, SEEK_SET) == 0);
+#else
+        return (fseeko(m_file, (off_t)a_offset, SEEK_SET) == 0);
+#endif
+    }
+
+    unsigned long long getFileSize()
+    {
+#ifdef _WIN32
+        _fseeki64(m_file, 0, SEEK_END);
+        return (unsigned long long)_ftelli64(m_file);
+#else
+        fseeko(m_file, 0, SEEK_END);
+        return (unsigned long long)ftello(m_file);
+#endif
+    }
+
+    bool readChunkHeader(unsigned int& a_count, unsigned int& a_bytes)
+    {
+        unsigned char header[TRACE_CHUNK_HEADER_BYTES];
+        if (fread(header, 1, TRACE_CHUNK_HEADER_BYTES, m_file) != TRACE_CHUNK_HEADER_BYTES) { return false; }
+
+        a_count = traceReadUint32(header);
+        a_bytes = traceReadUint32(header + 4);
+        return (a_count > 0 && a_count <= (unsigned int)TRACE_CHUNK_SAMPLES &&
+                a_bytes <= (unsigned int)(TRACE_CHUNK_SAMPLES * TRACE_MAX_SAMPLE_BYTES));
+    }
+
+    // read the index through the trailer at the end of the file
+    bool loadIndex()
+    {
+        unsigned long long size = getFileSize();
+        if (size < 8 + TRACE_TRAILER_BYTES) { return false; }
+
+        unsigned char trailer[TRACE_TRAILER_BYTES];
+        if (!seekFile(size - TRACE_TRAILER_BYTES) ||
+            fread(trailer, 1, TRACE_TRAILER_BYTES, m_file) != TRACE_TRAILER_BYTES ||
+            memcmp(trailer + 12, TRACE_INDEX_MAGIC, 8) != 0) { return false; }
+
+        unsigned long long offset = traceReadUint64(trailer);
+        unsigned int chunks = traceReadUint32(trailer + 8);
+        if (offset + (unsigned long long)chunks * TRACE_INDEX_RECORD_BYTES + TRACE_TRAILER_BYTES != size) { return false; }
+
+        std::vector<unsigned char> records((size_t)chunks * TRACE_INDEX_RECORD_BYTES);
+        if (!seekFile(offset) || fread(records.data(), 1, records.size(), m_file) != records.size()) { return false; }
+
+        m_index.resize(chunks);
+        for (unsigned int n = 0; n < chunks; n++)
+        {
+            m_index[n] = traceReadChunkInfo(&records[(size_t)n * TRACE_INDEX_RECORD_BYTES]);
+        }
+        return true;
+    }
+
+    // decode all complete chunks from the start of the file to rebuild their summaries
+    void rebuildIndex()
+    {
+        m_index.clear();
+
+        unsigned long long offset = 8;
+        unsigned int previousButtons = 0;
+        std::vector<TraceSample> samples;
+        while (seekFile(offset))
+        {
+            unsigned int count, bytes;
+            if (!readChunkHeader(count, bytes)) { break; }
+
+            m_payload.resize(bytes);
+            samples.resize(count);
+            if (fread(m_payload.data(), 1, bytes, m_file) != bytes ||
+                !m_decoder.decodeChunk(m_payload.data(), m_payload.data() + bytes, (int)count, samples.data())) { break; }
+
+            TraceChunkInfo info;
+            info.m_offset = offset;
+            info.m_count = 0;
+            info.m_buttonEvents = 0;
+            for (unsigned int n = 0; n < count; n++)
+            {
+                traceAccumulate(info, samples[n], previousButtons);
+                previousButtons = samples[n].m_buttons;
+            }
+            m_index.push_back(info);
+
+            offset += TRACE_CHUNK_HEADER_BYTES + bytes;
+        }
+    }
+
+    FILE* m_file;
+    bool m_recovered;
+    std::vector<TraceChunkInfo> m_index;
+    std::vector<double> m_startTimes;
+
+    TraceDecoder m_decoder;
+    std::vector<unsigned char> m_payload;
+
+    std::vector<TraceSample> m_samples;
+    int m_chunk;
+    size_t m_next;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,195 @@
+//==============================================================================
+/*
+    TraceWriter.h
+
+    Records device samples to a compressed trace file (see TraceCodec.h).
+
+    The haptic thread only copies each sample into a lock-free ring; a
+    writer thread drains the ring, encodes the samples into chunks and
+    writes them to disk. A slow disk therefore never stalls the haptic
+    loop: if the ring overflows, samples are dropped and counted.
+
+    The writer also summarizes each chunk and writes the chunk index and
+    trailer when the recording is closed.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef TraceWriterH
+#define TraceWriterH
+//------------------------------------------------------------------------------
+#include "SpscRing.h"
+#include "TraceCodec.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+class TraceWriter
+{
+public:
+
+    // samples buffered between the haptic and the writer thread (8 s at 1 kHz)
+    static const int RING_CAPACITY = 8192;
+
+    TraceWriter()
+    {
+        m_file = NULL;
+        m_droppedAtOpen = 0;
+        m_recording.store(false);
+        m_samples.store(0);
+        m_bytes.store(0);
+    }
+
+    ~TraceWriter() { close(); }
+
+    // create a_filename and start the writer thread, returns false if the file cannot be opened
+    bool open(const char* a_filename)
+    {
+        close();
+
+        m_file = fopen(a_filename, "wb");
+        if (m_file == NULL) { return false; }
+        fwrite(TRACE_MAGIC, 1, 8, m_file);
+
+        // discard samples left over from a previous recording
+        TraceSample sample;
+        while (m_ring.pop(sample)) {}
+
+        m_droppedAtOpen = m_ring.getDropped();
+        m_samples.store(0);
+        m_bytes.store(8);
+        m_index.clear();
+        m_chunk.m_count = 0;
+        m_chunk.m_buttonEvents = 0;
+        m_chunkBytes = 0;
+        m_previousButtons = 0;
+
+        m_recording.store(true, std::memory_order_release);
+        m_thread = std::thread(&TraceWriter::run, this);
+        return true;
+    }
+
+    // stop recording, write the remaining samples and the index, and close the file
+    void close()
+    {
+        if (!m_thread.joinable()) { return; }
+
+        m_recording.store(false, std::memory_order_release);
+        m_thread.join();
+
+        writeIndex();
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    bool isRecording() const { return m_recording.load(std::memory_order_acquire); }
+
+    // queue a sample, returns false if not recording or the ring is full (haptic thread)
+    bool push(const TraceSample& a_sample)
+    {
+        if (!isRecording()) { return false; }
+        return m_ring.push(a_sample);
+    }
+
+    // samples and bytes written so far, and samples lost to a full ring (any thread)
+    unsigned long long getSamples() const { return m_samples.load(std::memory_order_relaxed); }
+    unsigned long long getBytes() const { return m_bytes.load(std::memory_order_relaxed); }
+    unsigned long long getDropped() const { return m_ring.getDropped() - m_droppedAtOpen; }
+
+private:
+
+    // writer thread: drain the ring until recording stops
+    void run()
+    {
+        while (true)
+        {
+            bool recording = isRecording();
+
+            int count = 0;
+            TraceSample sample;
+            while (m_ring.pop(sample))
+            {
+                append(sample);
+                count++;
+            }
+
+            if (!recording) { break; }
+            if (count == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        }
+
+        writeChunk();
+    }
+
+    void append(const TraceSample& a_sample)
+    {
+        if (m_chunk.m_count == 0) { m_encoder.reset(); }
+
+        m_chunkBytes += m_encoder.encode(a_sample, m_buffer + TRACE_CHUNK_HEADER_BYTES + m_chunkBytes);
+        traceAccumulate(m_chunk, a_sample, m_previousButtons);
+        m_previousButtons = a_sample.m_buttons;
+
+        if (m_chunk.m_count == (unsigned int)TRACE_CHUNK_SAMPLES) { writeChunk(); }
+    }
+
+    void writeChunk()
+    {
+        if (m_chunk.m_count == 0) { return; }
+
+        unsigned long long offset = m_bytes.load(std::memory_order_relaxed);
+        traceWriteUint32(m_chunk.m_count, m_buffer);
+        traceWriteUint32(m_chunkBytes, m_buffer + 4);
+        fwrite(m_buffer, 1, TRACE_CHUNK_HEADER_BYTES + m_chunkBytes, m_file);
+
+        m_chunk.m_offset = offset;
+        m_index.push_back(m_chunk);
+
+        m_samples.store(m_samples.load(std::memory_order_relaxed) + m_chunk.m_count, std::memory_order_relaxed);
+        m_bytes.store(offset + TRACE_CHUNK_HEADER_BYTES + m_chunkBytes, std::memory_order_relaxed);
+        m_chunk.m_count = 0;
+        m_chunk.m_buttonEvents = 0;
+        m_chunkBytes = 0;
+    }
+
+    void writeIndex()
+    {
+        unsigned long long offset = m_bytes.load(std::memory_order_relaxed);
+
+        unsigned char record[TRACE_INDEX_RECORD_BYTES];
+        for (size_t n = 0; n < m_index.size(); n++)
+        {
+            traceWriteChunkInfo(m_index[n], record);
+            fwrite(record, 1, TRACE_INDEX_RECORD_BYTES, m_file);
+        }
+
+        unsigned char trailer[TRACE_TRAILER_BYTES];
+        traceWriteUint64(offset, trailer);
+        traceWriteUint32((unsigned int)m_index.size(), trailer + 8);
+        memcpy(trailer + 12, TRACE_INDEX_MAGIC, 8);
+        fwrite(trailer, 1, TRACE_TRAILER_BYTES, m_file);
+
+        m_bytes.store(offset + m_index.size() * TRACE_INDEX_RECORD_BYTES + TRACE_TRAILER_BYTES, std::memory_order_relaxed);
+    }
+
+    SpscRing<TraceSample, RING_CAPACITY> m_ring;
+    unsigned long long m_droppedAtOpen;
+
+    FILE* m_file;
+    std::thread m_thread;
+    std::atomic<bool> m_recording;
+    std::atomic<unsigned long long> m_samples;
+    std::atomic<unsigned long long> m_bytes;
+
+    TraceEncoder m_encoder;
+    unsigned char m_buffer[TRACE_CHUNK_HEADER_BYTES + TRACE_CHUNK_SAMPLES * TRACE_MAX_SAMPLE_BYTES];
+    TraceChunkInfo m_chunk;
+    int m_chunkBytes;
+    unsigned int m_previousButtons;
+    std::vector<TraceChunkInfo> m_index;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+//==============================================================================
+/*
+    WorkspaceBound.h
+
+    Keeps predictions inside the reach of the device. CHAI3D describes the
+    workspace as a sphere of m_workspaceRadius (cHapticDeviceInfo) around
+    the origin of the device coordinates; a predicted position outside it
+    is moved radially onto the sphere, the outward part of its velocity is
+    removed, and the prediction is counted as impossible.
+
+    Applied by the haptic thread to every prediction it renders (after the
+    prediction has been scored); the count can be read from any thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef WorkspaceBoundH
+#define WorkspaceBoundH
+//------------------------------------------------------------------------------
+#include "MotionPredictor.h"
+#include <atomic>
+#include <cmath>
+//------------------------------------------------------------------------------
+
+class WorkspaceBound
+{
+public:
+
+    // a_radius: workspace radius [m], 0 leaves predictions unbounded
+    WorkspaceBound(double a_radius = 0.0)
+    {
+        setRadius(a_radius);
+        m_violations.store(0);
+    }
+
+    // radius [m] (from the device specifications, read once at startup)
+    void setRadius(double a_radius) { m_radius = (a_radius > 0.0) ? a_radius : 0.0; }
+    double getRadius() const { return m_radius; }
+
+    // move a prediction that leaves the workspace back onto its boundary, true if it did
+    bool constrain(MotionPrediction& a_prediction)
+    {
+        double* p = a_prediction.m_position;
+        double distanceSquared = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        if (m_radius == 0.0 || distanceSquared <= m_radius * m_radius) { return false; }
+
+        double distance = std::sqrt(distanceSquared);
+        double normal[3] = { p[0] / distance, p[1] / distance, p[2] / distance };
+        double* v = a_prediction.m_velocity;
+        double outward = v[0] * normal[0] + v[1] * normal[1] + v[2] * normal[2];
+        for (int i = 0; i < 3; i++)
+        {
+            p[i] = m_radius * normal[i];
+            if (outward > 0.0) { v[i] -= outward * normal[i]; }
+        }
+
+        m_violations.store(m_violations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // predictions moved back into the workspace (any thread)
+    unsigned long long getViolations() const { return m_violations.load(std::memory_order_relaxed); }
+
+private:
+
+    double m_radius;
+    std::atomic<unsigned long long> m_violations;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,115 @@
+/*==============================================================================
+    CApiTest.c
+
+    The C interface, compiled as C: sizes and the storage, alignment and
+    parameter checks of gtp_predictor_create() and
+    gtp_predictor_set_parameters(), then every predictor type created in
+    place, fed a constant-velocity motion and asked for a prediction.
+==============================================================================*/
+
+/*----------------------------------------------------------------------------*/
+#include "gtp_predictor.h"
+#include "tests/TestCheck.h"
+#include <math.h>
+/*----------------------------------------------------------------------------*/
+
+/* number of predictor types */
+#define NUM_TYPES 7
+
+/* storage large enough and more aligned than any predictor needs */
+static _Alignas(64) unsigned char storage[1 << 20];
+
+/*----------------------------------------------------------------------------*/
+
+/* rejected parameter blocks: each one has a single value out of range */
+static void checkParameters(void)
+{
+    gtp_parameters defaults;
+    gtp_parameters bad;
+    gtp_parameters_default(&defaults);
+
+    bad = defaults; bad.median_window = 4;
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, &bad, storage, sizeof(storage)) == NULL);
+    bad = defaults; bad.rls_forgetting = 0.0;
+    CHECK(gtp_predictor_create(GTP_RLS_AR, &bad, storage, sizeof(storage)) == NULL);
+    bad = defaults; bad.average_cycle = 1;
+    CHECK(gtp_predictor_create(GTP_RUNNING_AVERAGE, &bad, storage, sizeof(storage)) == NULL);
+    bad = defaults; bad.velocity_limit[2] = 0.0;
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, &bad, storage, sizeof(storage)) == NULL);
+    bad = defaults; bad.score_horizon = -0.1;
+    CHECK(gtp_predictor_create(GTP_ENSEMBLE_BEST, &bad, storage, sizeof(storage)) == NULL);
+
+    /* the same checks when changing the parameters; the predictor keeps working */
+    gtp_predictor* predictor = gtp_predictor_create(GTP_ENSEMBLE_BLEND, &defaults, storage, sizeof(storage));
+    CHECK(predictor != NULL);
+    if (predictor == NULL) { return; }
+    CHECK(gtp_predictor_set_parameters(predictor, NULL) == 0);
+    bad = defaults; bad.tracker_memory = 0.0;
+    CHECK(gtp_predictor_set_parameters(predictor, &bad) == 0);
+    bad = defaults; bad.score_horizon = -1.0;
+    CHECK(gtp_predictor_set_parameters(predictor, &bad) == 0);
+    bad = defaults; bad.score_horizon = 0.2; bad.median_window = 5;
+    CHECK(gtp_predictor_set_parameters(predictor, &bad) == 1);
+    gtp_predictor_destroy(predictor);
+}
+
+/* a_type fed 2 s of motion at 0.1 m/s along x, sampled at 1 kHz */
+static void checkType(gtp_predictor_type a_type)
+{
+    const double speed = 0.1;
+    const double horizon = 0.05;
+    size_t size = gtp_predictor_size(a_type);
+    CHECK(size > 0 && size <= sizeof(storage));
+
+    gtp_predictor* predictor = gtp_predictor_create(a_type, NULL, storage, size);
+    CHECK(predictor == (gtp_predictor*)storage);
+    if (predictor == NULL) { return; }
+
+    /* twice, the second time after a reset */
+    for (int pass = 0; pass < 2; pass++)
+    {
+        gtp_sample sample = { 0.0, { 0.0, 0.0, 0.0 }, { speed, 0.0, 0.0 } };
+        for (int n = 0; n < 2000; n++)
+        {
+            sample.time = 0.001 * n;
+            sample.position[0] = speed * sample.time;
+            gtp_predictor_push_sample(predictor, &sample);
+        }
+
+        /* between the latest position and its extrapolation, on the line of motion */
+        gtp_prediction prediction;
+        gtp_predictor_predict(predictor, horizon, &prediction);
+        CHECK(prediction.position[0] >= sample.position[0] - 1e-6);
+        CHECK(prediction.position[0] <= sample.position[0] + speed * horizon + 1e-6);
+        CHECK(fabs(prediction.position[1]) < 1e-9 && fabs(prediction.position[2]) < 1e-9);
+        CHECK(prediction.velocity[0] >= 0.0 && prediction.velocity[0] <= speed + 1e-6);
+
+        gtp_predictor_reset(predictor);
+    }
+    gtp_predictor_destroy(predictor);
+}
+
+/*----------------------------------------------------------------------------*/
+
+int main(void)
+{
+    size_t alignment = gtp_predictor_alignment();
+    CHECK(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= 64);
+    CHECK(gtp_predictor_size((gtp_predictor_type)NUM_TYPES) == 0);
+    CHECK(gtp_predictor_size((gtp_predictor_type)-1) == 0);
+
+    /* unknown type, missing, too small and misaligned storage */
+    size_t size = gtp_predictor_size(GTP_THRESHOLD);
+    CHECK(gtp_predictor_create((gtp_predictor_type)NUM_TYPES, NULL, storage, sizeof(storage)) == NULL);
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, NULL, NULL, size) == NULL);
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, NULL, storage, size - 1) == NULL);
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, NULL, storage + alignment / 2, size) == NULL);
+    CHECK(gtp_predictor_create(GTP_THRESHOLD, NULL, storage + alignment, size) != NULL);
+    gtp_predictor_destroy((gtp_predictor*)(storage + alignment));
+    gtp_predictor_destroy(NULL);
+
+    checkParameters();
+    for (int type = 0; type < NUM_TYPES; type++) { checkType((gtp_predictor_type)type); }
+
+    return testResult("CApiTest");
+}
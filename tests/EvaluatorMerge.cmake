@@ -0,0 +1,52 @@
+#===============================================================================
+# EvaluatorMerge.cmake
+#
+# The statistics of TraceEvaluator must not depend on the number of worker
+# threads: the same traces are evaluated on one and on several threads and
+# the reports must be identical, apart from the line with the timing. Workers
+# reuse their predictors through reset(), so this also catches a reset that
+# leaves state behind. Every predictor is run, and those with a threshold
+# predictor once more with its adaptive thresholds.
+#
+#   cmake -DEVALUATOR=<TraceEvaluator> -DTRACE=<trace> -P EvaluatorMerge.cmake
+#===============================================================================
+
+if(NOT EVALUATOR OR NOT TRACE)
+    message(FATAL_ERROR "usage: cmake -DEVALUATOR=<TraceEvaluator> -DTRACE=<trace> -P EvaluatorMerge.cmake")
+endif()
+
+# the trace several times, for more units than threads
+set(TRACES ${TRACE} ${TRACE} ${TRACE} ${TRACE} ${TRACE})
+
+# evaluate with PREDICTOR and the options after it on 1, 4 and 7 threads and compare
+function(compare_thread_counts PREDICTOR)
+    set(NAME ${PREDICTOR} ${ARGN})
+    string(REPLACE ";" " " NAME "${NAME}")
+    set(REFERENCE "")
+    foreach(THREADS 1 4 7)
+        execute_process(
+            COMMAND ${EVALUATOR} -predictor ${PREDICTOR} ${ARGN} -threads ${THREADS} ${TRACES}
+            RESULT_VARIABLE RESULT
+            OUTPUT_VARIABLE REPORT
+            ERROR_VARIABLE REPORT)
+        if(NOT RESULT EQUAL 0)
+            message(FATAL_ERROR "${NAME} on ${THREADS} threads failed (${RESULT}):\n${REPORT}")
+        endif()
+        string(REGEX REPLACE "[^\n]* units on [^\n]*" "" REPORT "${REPORT}")
+
+        if(THREADS EQUAL 1)
+            set(REFERENCE "${REPORT}")
+        elseif(NOT REPORT STREQUAL REFERENCE)
+            message(FATAL_ERROR "${NAME}: report on ${THREADS} threads differs from one thread:\n"
+                "${REPORT}\none thread:\n${REFERENCE}")
+        endif()
+    endforeach()
+    message(STATUS "${NAME}: same report on 1, 4 and 7 threads")
+endfunction()
+
+foreach(PREDICTOR threshold running-average savitzky-golay alpha-beta-gamma rls-ar ensemble-best ensemble-blend)
+    compare_thread_counts(${PREDICTOR})
+endforeach()
+foreach(PREDICTOR threshold ensemble-best ensemble-blend)
+    compare_thread_counts(${PREDICTOR} -adaptive)
+endforeach()
@@ -0,0 +1,64 @@
+//==============================================================================
+/*
+    KernelAccuracyTest.cpp
+
+    The single precision build of the predictor kernels against the double
+    reference (built with PREDICTION_FLOAT32): at the prediction rate and
+    horizon of the threshold program, the filtered and the extrapolated
+    positions must stay below the position resolution of the Touch. The
+    predictors themselves must also run in that build.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "graphics/SceneSettings.h"
+#include "prediction/KernelAccuracy.h"
+#include "prediction/Predictors.h"
+#include "tests/TestCheck.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+#ifndef PREDICTION_FLOAT32
+#error "KernelAccuracyTest checks the PREDICTION_FLOAT32 build"
+#endif
+
+// prediction rate [Hz] of the threshold program
+const double PREDICT_RATE = 1000.0;
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    static_assert(sizeof(PredictionScalar) == sizeof(float), "PREDICTION_FLOAT32 selects float kernels");
+
+    KernelAccuracy accuracy = checkKernelAccuracy<PredictionScalar, SG_HALF_WINDOW>(PREDICT_RATE, 0.2 * PREDICT_RATE, PREDICTION_HORIZON);
+    printf("float32 kernels: max deviation from double %.5f mm (position), %.5f mm (prediction), %.3g m/s (velocity)\n",
+           1000.0 * accuracy.m_maxPositionError, 1000.0 * accuracy.m_maxPredictionError, accuracy.m_maxVelocityError);
+    CHECK(accuracy.m_maxPositionError < TOUCH_POSITION_RESOLUTION);
+    CHECK(accuracy.m_maxPredictionError < TOUCH_POSITION_RESOLUTION);
+
+    // the threshold predictor on the Savitzky-Golay velocity in single precision: a steady
+    // motion predicted like in double precision, within the device resolution
+    ThresholdPredictor predictor;
+    predictor.setUseSavitzkyGolay(true);
+    MotionSample sample;
+    for (int n = 0; n < 2000; n++)
+    {
+        sample.m_time = 5.0 + n / PREDICT_RATE;
+        for (int i = 0; i < 3; i++)
+        {
+            sample.m_position[i] = 0.03 * (i - 1) + 0.02 * (n / PREDICT_RATE);
+            sample.m_velocity[i] = 0.02;
+        }
+        predictor.update(sample);
+    }
+    MotionPrediction prediction;
+    predictor.predict(PREDICTION_HORIZON, prediction);
+    for (int i = 0; i < 3; i++)
+    {
+        double expected = sample.m_position[i] + 0.02 * PREDICTION_HORIZON;
+        CHECK(fabs(prediction.m_position[i] - expected) < TOUCH_POSITION_RESOLUTION);
+    }
+
+    return testResult("KernelAccuracyTest");
+}
@@ -0,0 +1,120 @@
+//==============================================================================
+/*
+    MedianFilterTest.cpp
+
+    The median networks of MedianFilter against a sort: every permutation
+    of distinct values for each window (the networks hold for any input
+    once they hold for all permutations), then long random streams with
+    ties, different on every lane, including the fill after a reset.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/MedianFilter.h"
+#include "tests/TestCheck.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+const int LANES = 4;
+typedef MedianFilter<double, LANES> Filter;
+
+//------------------------------------------------------------------------------
+
+// median of the last a_window values of a_history (the first value repeated before it)
+double sortedMedian(const vector<double>& a_history, int a_window)
+{
+    vector<double> window;
+    for (int k = 0; k < a_window; k++)
+    {
+        int n = (int)a_history.size() - 1 - k;
+        window.push_back(a_history[(n < 0) ? 0 : n]);
+    }
+    sort(window.begin(), window.end());
+    return window[a_window / 2];
+}
+
+// every permutation of a_window distinct values, the last one being the current sample
+void checkPermutations(int a_window)
+{
+    vector<double> values(a_window);
+    for (int k = 0; k < a_window; k++) { values[k] = (double)k; }
+
+    int failures = 0;
+    do
+    {
+        Filter filter(a_window);
+        Filter::Vector output;
+        for (int k = 0; k < a_window; k++)
+        {
+            // lanes see the same permutation in reverse or shifted order
+            for (int i = 0; i < LANES; i++)
+            {
+                output.m_value[i] = values[(k + i) % a_window];
+            }
+            filter.filter(output);
+        }
+        for (int i = 0; i < LANES; i++)
+        {
+            if (output.m_value[i] != (double)(a_window / 2)) { failures++; }
+        }
+    }
+    while (next_permutation(values.begin(), values.end()));
+
+    CHECK(failures == 0);
+}
+
+// random streams with many ties against the sorted window, a reset halfway
+void checkStreams(int a_window)
+{
+    srand(1234 + a_window);
+    Filter filter(a_window);
+    vector<double> history[LANES];
+
+    int failures = 0;
+    for (int n = 0; n < 20000; n++)
+    {
+        if (n == 10000)
+        {
+            filter.reset();
+            for (int i = 0; i < LANES; i++) { history[i].clear(); }
+        }
+
+        Filter::Vector value;
+        for (int i = 0; i < LANES; i++)
+        {
+            value.m_value[i] = (double)(rand() % (3 + 4 * i)) - 0.5 * i;
+            history[i].push_back(value.m_value[i]);
+        }
+        filter.filter(value);
+        for (int i = 0; i < LANES; i++)
+        {
+            if (value.m_value[i] != sortedMedian(history[i], a_window)) { failures++; }
+        }
+    }
+
+    CHECK(failures == 0);
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    // supported windows, and other values rounded down to them
+    CHECK(Filter(1).getWindow() == 1);
+    CHECK(Filter(4).getWindow() == 3);
+    CHECK(Filter(6).getWindow() == 5);
+    CHECK(Filter(9).getWindow() == 7);
+    CHECK(Filter(7).getLag() == 3);
+
+    for (int window = 1; window <= Filter::MAX_WINDOW; window += 2)
+    {
+        checkPermutations(window);
+        checkStreams(window);
+    }
+
+    return testResult("MedianFilterTest");
+}
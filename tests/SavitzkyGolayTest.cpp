@@ -0,0 +1,106 @@
+//==============================================================================
+/*
+    SavitzkyGolayTest.cpp
+
+    Savitzky-Golay weights and differentiator. The weights of a quadratic
+    fit must reproduce the derivatives of 1, k and k^2 exactly (moment
+    conditions), and the differentiator must recover velocity and
+    acceleration of a quadratic trajectory without error, at the centre
+    and at the newest sample of the window.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/Predictors.h"
+#include "prediction/SavitzkyGolay.h"
+#include "tests/TestCheck.h"
+#include <cmath>
+//------------------------------------------------------------------------------
+
+// a_weight(k, m) summed against k^a_power over the window
+double moment(double (*a_weight)(int, int), int a_m, int a_power)
+{
+    double sum = 0.0;
+    for (int k = -a_m; k <= a_m; k++) { sum += a_weight(k, a_m) * pow((double)k, a_power); }
+    return sum;
+}
+
+double velocityWeight(int a_k, int a_m) { return sgVelocityWeight(a_k, a_m); }
+double accelerationWeight(int a_k, int a_m) { return sgAccelerationWeight(a_k, a_m); }
+double latestVelocityWeight(int a_k, int a_m) { return sgLatestVelocityWeight(a_k, a_m); }
+
+// derivatives of 1, k and k^2 at the centre (and at k = m for the latest velocity)
+void checkWeights(int a_m)
+{
+    const double tolerance = 1e-12;
+    CHECK(fabs(moment(velocityWeight, a_m, 0)) < tolerance);
+    CHECK(fabs(moment(velocityWeight, a_m, 1) - 1.0) < tolerance);
+    CHECK(fabs(moment(velocityWeight, a_m, 2)) < tolerance);
+
+    CHECK(fabs(moment(accelerationWeight, a_m, 0)) < tolerance);
+    CHECK(fabs(moment(accelerationWeight, a_m, 1)) < tolerance);
+    CHECK(fabs(moment(accelerationWeight, a_m, 2) - 2.0) < tolerance);
+
+    CHECK(fabs(moment(latestVelocityWeight, a_m, 0)) < tolerance);
+    CHECK(fabs(moment(latestVelocityWeight, a_m, 1) - 1.0) < tolerance);
+    CHECK(fabs(moment(latestVelocityWeight, a_m, 2) - 2.0 * a_m) < tolerance);
+
+    // antisymmetric velocity, symmetric acceleration weights
+    for (int k = 1; k <= a_m; k++)
+    {
+        CHECK(sgVelocityWeight(k, a_m) == -sgVelocityWeight(-k, a_m));
+        CHECK(sgAccelerationWeight(k, a_m) == sgAccelerationWeight(-k, a_m));
+    }
+}
+
+// a quadratic trajectory per axis at 1 kHz
+template <int HALF_WINDOW, typename T>
+void checkDifferentiator(double a_tolerance)
+{
+    typedef SavitzkyGolayDifferentiator<HALF_WINDOW, T> Differentiator;
+    const double period = 0.001;
+    const double p0[3] = { 0.01, -0.02, 0.005 };
+    const double v0[3] = { 0.03, 0.0, -0.05 };
+    const double a0[3] = { 0.4, -1.5, 0.0 };
+
+    Differentiator differentiator;
+    CHECK(!differentiator.isReady());
+
+    for (int n = 0; n < Differentiator::WINDOW + 10; n++)
+    {
+        double s = n * period;
+        double position[3];
+        for (int i = 0; i < 3; i++) { position[i] = p0[i] + v0[i] * s + 0.5 * a0[i] * s * s; }
+        differentiator.push(3.0 + s, position);
+    }
+    CHECK(differentiator.isReady());
+    CHECK(fabs(differentiator.getSamplePeriod() - period) < 1e-9);
+    CHECK(fabs(differentiator.getLagSeconds() - HALF_WINDOW * period) < 1e-9);
+
+    double newest = (Differentiator::WINDOW + 9) * period;
+    double centre = newest - HALF_WINDOW * period;
+    double velocity[3], latest[3], acceleration[3];
+    differentiator.getVelocity(velocity);
+    differentiator.getLatestVelocity(latest);
+    differentiator.getAcceleration(acceleration);
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(fabs(velocity[i] - (v0[i] + a0[i] * centre)) < a_tolerance);
+        CHECK(fabs(latest[i] - (v0[i] + a0[i] * newest)) < a_tolerance);
+        CHECK(fabs(acceleration[i] - a0[i]) < 1000.0 * a_tolerance);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int main()
+{
+    for (int m = 1; m <= 12; m++) { checkWeights(m); }
+
+    checkDifferentiator<1, double>(1e-6);
+    checkDifferentiator<SG_HALF_WINDOW, double>(1e-6);
+    checkDifferentiator<10, double>(1e-6);
+    checkDifferentiator<SG_HALF_WINDOW, float>(1e-3);
+
+    return testResult("SavitzkyGolayTest");
+}
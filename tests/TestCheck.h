@@ -0,0 +1,34 @@
+//==============================================================================
+/*
+    TestCheck.h
+
+    Minimal checks for the test executables run by CTest. A failed check
+    prints its location and expression and the run goes on; the executable
+    returns non-zero if any check failed. Usable from C as well, for the
+    tests of the C interface.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef TestCheckH
+#define TestCheckH
+//------------------------------------------------------------------------------
+#include <stdio.h>
+//------------------------------------------------------------------------------
+
+// failed checks so far
+static int testFailures = 0;
+
+#define CHECK(a_condition) \
+    do { if (!(a_condition)) { printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #a_condition); testFailures++; } } while (0)
+
+// report and exit code of the test executable a_name
+static int testResult(const char* a_name)
+{
+    printf("%s: %s (%d failed)\n", a_name, (testFailures == 0) ? "passed" : "FAILED", testFailures);
+    return (testFailures == 0) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
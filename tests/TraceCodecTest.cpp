@@ -0,0 +1,312 @@
+//==============================================================================
+/*
+    TraceCodecTest.cpp
+
+    Round trip of a synthetic recording through TraceWriter and TraceReader:
+    every field must come back within half its quantization step, the
+    buttons exactly, and the chunk index must describe the chunks. Seeking
+    by time must land on the first sample at or after that time, also in
+    a copy without index (an interrupted recording). A second recording
+    with speed extremes and button transitions placed in particular chunks
+    must come back with exactly those chunk summaries, from the index and
+    rebuilt without it.
+
+    TraceCodecTest [<trace>]   (the trace is kept for the evaluator test)
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/TraceReader.h"
+#include "prediction/TraceWriter.h"
+#include "tests/TestCheck.h"
+#include <cmath>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+// samples of the recording: several chunks and a partial last one
+const int NUM_SAMPLES = 20 * TRACE_CHUNK_SAMPLES + 300;
+
+// chunks of the summary recording, the last one partial
+const int SUMMARY_CHUNKS = 7;
+const int SUMMARY_SAMPLES = (SUMMARY_CHUNKS - 1) * TRACE_CHUNK_SAMPLES + 200;
+
+//------------------------------------------------------------------------------
+
+// write a_samples to a_filename; a sample the full ring refuses is counted as dropped and
+// pushed again
+void record(const char* a_filename, const vector<TraceSample>& a_samples)
+{
+    TraceWriter writer;
+    CHECK(writer.open(a_filename));
+    unsigned long long refused = 0;
+    for (size_t n = 0; n < a_samples.size(); n++)
+    {
+        while (!writer.push(a_samples[n]))
+        {
+            refused++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    writer.close();
+    CHECK(writer.getSamples() == (unsigned long long)a_samples.size());
+    CHECK(writer.getDropped() == refused);
+}
+
+// copy of a_filename without its index of a_numChunks records and trailer, as left by an
+// interrupted recording; returns its name
+string copyWithoutIndex(const char* a_filename, int a_numChunks)
+{
+    string name = string(a_filename) + ".noindex";
+    FILE* in = fopen(a_filename, "rb");
+    FILE* out = fopen(name.c_str(), "wb");
+    CHECK(in != NULL && out != NULL);
+    if (in != NULL && out != NULL)
+    {
+        fseek(in, 0, SEEK_END);
+        long size = ftell(in) - (long)a_numChunks * TRACE_INDEX_RECORD_BYTES - TRACE_TRAILER_BYTES;
+        fseek(in, 0, SEEK_SET);
+        vector<char> data(size);
+        CHECK(fread(data.data(), 1, size, in) == (size_t)size);
+        fwrite(data.data(), 1, size, out);
+    }
+    if (in != NULL) { fclose(in); }
+    if (out != NULL) { fclose(out); }
+    return name;
+}
+
+//------------------------------------------------------------------------------
+
+// index of the first sample at or after a_time, NUM_SAMPLES if none
+int firstAtOrAfter(const vector<TraceSample>& a_samples, double a_time)
+{
+    int n = 0;
+    while (n < NUM_SAMPLES && a_samples[n].m_time < a_time) { n++; }
+    return n;
+}
+
+// seek to a set of times (before, inside, between and after the samples) and compare
+// the sample that follows with the recording
+void checkSeek(TraceReader& a_reader, const vector<TraceSample>& a_samples)
+{
+    vector<double> times;
+    times.push_back(a_samples[0].m_time - 1.0);
+    times.push_back(a_samples[0].m_time);
+    times.push_back(a_samples[NUM_SAMPLES - 1].m_time);
+    times.push_back(a_samples[NUM_SAMPLES - 1].m_time + 1.0);
+    for (int c = 0; c * TRACE_CHUNK_SAMPLES < NUM_SAMPLES; c++)
+    {
+        int n = c * TRACE_CHUNK_SAMPLES;
+        times.push_back(a_samples[n].m_time);
+        if (n > 0) { times.push_back(0.5 * (a_samples[n - 1].m_time + a_samples[n].m_time)); }
+        if (n + 517 < NUM_SAMPLES) { times.push_back(a_samples[n + 517].m_time + 0.0004); }
+    }
+
+    for (size_t k = 0; k < times.size(); k++)
+    {
+        // times on samples are compared after quantization
+        double time = floor(times[k] / TRACE_TIME_STEP + 0.5) * TRACE_TIME_STEP;
+        int expected = firstAtOrAfter(a_samples, time - 0.5 * TRACE_TIME_STEP);
+
+        CHECK(a_reader.seek(time));
+        TraceSample sample;
+        bool found = a_reader.next(sample);
+        CHECK(found == (expected < NUM_SAMPLES));
+        if (found && expected < NUM_SAMPLES)
+        {
+            CHECK(fabs(sample.m_time - a_samples[expected].m_time) <= TRACE_TIME_STEP);
+        }
+
+        // last chunk starting at or before the time (the first one before the trace)
+        int chunk = a_reader.findChunk(time);
+        CHECK(chunk >= 0 && chunk < a_reader.getNumChunks());
+        if (chunk > 0) { CHECK(a_reader.getChunkInfo(chunk).m_startTime <= time); }
+        if (chunk + 1 < a_reader.getNumChunks()) { CHECK(a_reader.getChunkInfo(chunk + 1).m_startTime > time); }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// sample n of a 1 kHz recording with slightly irregular time stamps
+TraceSample makeSample(int a_n)
+{
+    TraceSample sample;
+    double t = 0.001 * a_n + 2e-5 * sin(0.7 * a_n);
+    sample.m_time = 12.5 + t;
+    for (int i = 0; i < 3; i++)
+    {
+        double frequency = 0.3 + 0.2 * i;
+        sample.m_position[i] = 0.04 * sin(2.0 * M_PI * frequency * t + i);
+        sample.m_velocity[i] = 0.04 * 2.0 * M_PI * frequency * cos(2.0 * M_PI * frequency * t + i) + 0.002 * sin(3.1 * a_n);
+    }
+    double angle = 0.5 * sin(0.2 * t);
+    double rotation[9] = { cos(angle), -sin(angle), 0.0, sin(angle), cos(angle), 0.0, 0.0, 0.0, 1.0 };
+    for (int k = 0; k < 9; k++) { sample.m_rotation[k] = rotation[k]; }
+    sample.m_gripperAngle = 0.3 * sin(0.5 * t);
+    sample.m_buttons = ((a_n / 700) % 2) | (((a_n / 1900) % 2) << 1);
+    return sample;
+}
+
+//------------------------------------------------------------------------------
+
+// expected summary of a chunk of the summary recording
+struct ExpectedSummary
+{
+    unsigned int m_buttonEvents;
+    double m_minSpeed;
+    double m_maxSpeed;
+};
+
+// summaries the reader reports for the summary recording, against a_expected
+void checkSummaries(const TraceReader& a_reader, const vector<TraceSample>& a_samples, const ExpectedSummary* a_expected)
+{
+    CHECK(a_reader.getNumChunks() == SUMMARY_CHUNKS);
+    for (int c = 0; c < a_reader.getNumChunks() && c < SUMMARY_CHUNKS; c++)
+    {
+        const TraceChunkInfo& info = a_reader.getChunkInfo(c);
+        int first = c * TRACE_CHUNK_SAMPLES;
+        int last = (c + 1 < SUMMARY_CHUNKS) ? first + TRACE_CHUNK_SAMPLES - 1 : SUMMARY_SAMPLES - 1;
+        CHECK(info.m_count == (unsigned int)(last - first + 1));
+        CHECK(info.m_startTime == a_samples[first].m_time);
+        CHECK(info.m_endTime == a_samples[last].m_time);
+        CHECK(info.m_buttonEvents == a_expected[c].m_buttonEvents);
+        CHECK(info.m_minSpeed == a_expected[c].m_minSpeed);
+        CHECK(info.m_maxSpeed == a_expected[c].m_maxSpeed);
+    }
+}
+
+// a recording on the quantization grid (so the summaries rebuilt from the decoded samples
+// equal those of the writer) with known speed extremes and button transitions per chunk
+void checkSummaryRecording(const char* a_filename)
+{
+    const double step = TRACE_VELOCITY_STEP;
+    const int CHUNK = TRACE_CHUNK_SAMPLES;
+
+    // speeds from 200 to 249 steps along x in every chunk, buttons released
+    vector<TraceSample> samples(SUMMARY_SAMPLES);
+    for (int n = 0; n < SUMMARY_SAMPLES; n++)
+    {
+        TraceSample& sample = samples[n];
+        sample.m_time = (double)(2000000 + 1000 * n) * TRACE_TIME_STEP;
+        for (int i = 0; i < 3; i++)
+        {
+            sample.m_position[i] = (double)(n % 700 - 300 * i) * TRACE_POSITION_STEP;
+            sample.m_velocity[i] = 0.0;
+        }
+        sample.m_velocity[0] = (double)(200 + n % 50) * step;
+        for (int k = 0; k < 9; k++) { sample.m_rotation[k] = (k % 4 == 0) ? 1.0 : 0.0; }
+        sample.m_gripperAngle = 0.0;
+        sample.m_buttons = 0;
+    }
+
+    // speed extremes: a fast sample in chunks 1 and 4, a device at rest in chunks 2 and 6
+    samples[CHUNK + 517].m_velocity[1] = 5000.0 * step;
+    samples[CHUNK + 517].m_velocity[0] = 0.0;
+    samples[4 * CHUNK + 3].m_velocity[2] = -7000.0 * step;
+    samples[4 * CHUNK + 3].m_velocity[0] = 0.0;
+    samples[2 * CHUNK + 1000].m_velocity[0] = 0.0;
+    samples[6 * CHUNK + 199].m_velocity[0] = 0.0;
+
+    // buttons: a click in chunk 0, a press on the last sample of chunk 3 released on the
+    // first of chunk 4, two changes in chunk 5 held into chunk 6 and released there
+    for (int n = 100; n < 300; n++) { samples[n].m_buttons = 1; }
+    samples[4 * CHUNK - 1].m_buttons = 2;
+    for (int n = 5 * CHUNK + 10; n < 6 * CHUNK + 50; n++) { samples[n].m_buttons = (n < 5 * CHUNK + 20) ? 5 : 4; }
+
+    const double low = 200.0 * step;
+    const double high = 249.0 * step;
+    const ExpectedSummary expected[SUMMARY_CHUNKS] =
+    {
+        { 2, low, high },
+        { 0, low, 5000.0 * step },
+        { 0, 0.0, high },
+        { 1, low, high },
+        { 1, low, 7000.0 * step },
+        { 2, low, high },
+        { 1, 0.0, high }
+    };
+
+    record(a_filename, samples);
+
+    TraceReader reader;
+    CHECK(reader.open(a_filename));
+    CHECK(!reader.isRecovered());
+    checkSummaries(reader, samples, expected);
+    reader.close();
+
+    string recoveredName = copyWithoutIndex(a_filename, SUMMARY_CHUNKS);
+    CHECK(reader.open(recoveredName.c_str()));
+    CHECK(reader.isRecovered());
+    checkSummaries(reader, samples, expected);
+    reader.close();
+    remove(recoveredName.c_str());
+    remove(a_filename);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const char* filename = (argc > 1) ? argv[1] : "TraceCodecTest.trace";
+
+    vector<TraceSample> samples(NUM_SAMPLES);
+    for (int n = 0; n < NUM_SAMPLES; n++) { samples[n] = makeSample(n); }
+
+    record(filename, samples);
+
+    // index
+    TraceReader reader;
+    CHECK(reader.open(filename));
+    CHECK(!reader.isRecovered());
+    int numChunks = (NUM_SAMPLES + TRACE_CHUNK_SAMPLES - 1) / TRACE_CHUNK_SAMPLES;
+    CHECK(reader.getNumChunks() == numChunks);
+    for (int c = 0; c < reader.getNumChunks(); c++)
+    {
+        const TraceChunkInfo& info = reader.getChunkInfo(c);
+        int first = c * TRACE_CHUNK_SAMPLES;
+        int count = (c + 1 < numChunks) ? TRACE_CHUNK_SAMPLES : NUM_SAMPLES - first;
+        CHECK(info.m_count == (unsigned int)count);
+        CHECK(fabs(info.m_startTime - samples[first].m_time) <= TRACE_TIME_STEP);
+        CHECK(fabs(info.m_endTime - samples[first + count - 1].m_time) <= TRACE_TIME_STEP);
+    }
+
+    // every sample within half a quantization step
+    const double* steps = traceFieldSteps();
+    TraceSample sample;
+    int read = 0;
+    int mismatches = 0;
+    while (reader.next(sample))
+    {
+        if (read < NUM_SAMPLES)
+        {
+            const double* expected = traceFields(samples[read]);
+            const double* actual = traceFields(sample);
+            for (int i = 0; i < TRACE_FIELDS; i++)
+            {
+                if (fabs(actual[i] - expected[i]) > 0.5 * steps[i] * (1.0 + 1e-6)) { mismatches++; }
+            }
+            if (sample.m_buttons != samples[read].m_buttons) { mismatches++; }
+        }
+        read++;
+    }
+    CHECK(read == NUM_SAMPLES);
+    CHECK(mismatches == 0);
+
+    checkSeek(reader, samples);
+    reader.close();
+
+    // the same recording without index and trailer
+    string recoveredName = copyWithoutIndex(filename, numChunks);
+    CHECK(reader.open(recoveredName.c_str()));
+    CHECK(reader.isRecovered());
+    CHECK(reader.getNumChunks() == numChunks);
+    checkSeek(reader, samples);
+    reader.close();
+    remove(recoveredName.c_str());
+
+    checkSummaryRecording((string(filename) + ".summary").c_str());
+
+    return testResult("TraceCodecTest");
+}
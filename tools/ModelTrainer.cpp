@@ -0,0 +1,495 @@
+//==============================================================================
+/*
+    ModelTrainer.cpp
+
+    Trains the autoregressive motion model of LearnedPredictor on recorded
+    traces and writes it for the programs and TraceEvaluator.
+
+    ModelTrainer [-type linear|mlp] [-order <n>] [-hidden <n>] [-horizon <s>]
+                 [-epochs <n>] [-scale <m/s>] [-out <file>] <trace> ...
+
+    Every sample of a trace yields one example per axis: the model inputs
+    at that sample (LearnedModel.h) and the mean velocity to the position
+    one horizon later. The last VALIDATION_FRACTION of every trace is held
+    out. A linear model is solved in closed form (ridge-regularized least
+    squares); an MLP is trained with Adam on mini-batches from a fixed
+    seed, so a run is reproducible. The errors are reported as position
+    error at the horizon, next to the error of extrapolating the device
+    velocity, and the inference time of LearnedPredictor is measured on
+    the validation samples.
+
+    Build from the repository root:
+        g++ -std=c++11 -O2 -I. tools/ModelTrainer.cpp -o ModelTrainer
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/LearnedModel.h"
+#include "prediction/LearnedPredictor.h"
+#include "prediction/TraceReader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// GENERAL SETTINGS
+//------------------------------------------------------------------------------
+
+// share of every trace held out for validation
+const double VALIDATION_FRACTION = 0.2;
+
+// examples kept for training (traces are subsampled evenly beyond this)
+const size_t MAX_EXAMPLES = 600000;
+
+// ridge regularization of the linear model, relative to the mean input power
+const double RIDGE = 1e-6;
+
+// Adam settings of the MLP
+const int BATCH_SIZE = 64;
+const double LEARNING_RATE = 1e-3;
+const double ADAM_BETA1 = 0.9;
+const double ADAM_BETA2 = 0.999;
+const double ADAM_EPSILON = 1e-8;
+
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// examples of one set, inputs stored row by row
+struct ExampleSet
+{
+    int m_numInputs;
+    vector<float> m_inputs;
+    vector<float> m_targets;
+
+    size_t size() const { return m_targets.size(); }
+    const float* input(size_t a_index) const { return &m_inputs[a_index * m_numInputs]; }
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//------------------------------------------------------------------------------
+
+// read every sample of a trace
+bool loadTrace(const char* a_filename, vector<TraceSample>& a_samples);
+
+// model output for one example (double precision, for training and reporting)
+double evaluate(const LearnedModel& a_model, const vector<double>& a_weights, const float* a_input, vector<double>* a_hidden);
+
+// root mean square error of the model output [model units]
+double rootMeanSquare(const LearnedModel& a_model, const vector<double>& a_weights, const ExampleSet& a_set);
+
+// fit the weights of a linear model
+void trainLinear(const LearnedModel& a_model, const ExampleSet& a_set, vector<double>& a_weights);
+
+// train the weights of an MLP
+void trainMlp(const LearnedModel& a_model, const ExampleSet& a_training, const ExampleSet& a_validation,
+              int a_epochs, vector<double>& a_weights);
+
+// copy the weights (flat, in file order) into a model
+void storeWeights(const vector<double>& a_weights, LearnedModel& a_model);
+
+
+//==============================================================================
+
+int main(int argc, char* argv[])
+{
+    LearnedModel model;
+    model.m_type = LEARNED_LINEAR;
+    model.m_order = 8;
+    model.m_hidden = 16;
+    model.m_horizon = 1.0;
+    model.m_scale = DEFAULT_VELOCITY_LIMIT;
+    int epochs = 10;
+    string output = "predictor.model";
+    vector<string> traces;
+    bool valid = true;
+
+    for (int n = 1; n < argc; n++)
+    {
+        if (strcmp(argv[n], "-type") == 0 && n + 1 < argc)
+        {
+            string type = argv[++n];
+            if (type == "linear") { model.m_type = LEARNED_LINEAR; }
+            else if (type == "mlp") { model.m_type = LEARNED_MLP; }
+            else { valid = false; }
+        }
+        else if (strcmp(argv[n], "-order") == 0 && n + 1 < argc) { model.m_order = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-hidden") == 0 && n + 1 < argc) { model.m_hidden = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-horizon") == 0 && n + 1 < argc) { model.m_horizon = atof(argv[++n]); }
+        else if (strcmp(argv[n], "-epochs") == 0 && n + 1 < argc) { epochs = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-scale") == 0 && n + 1 < argc) { model.m_scale = atof(argv[++n]); }
+        else if (strcmp(argv[n], "-out") == 0 && n + 1 < argc) { output = argv[++n]; }
+        else { traces.push_back(argv[n]); }
+    }
+    if (model.m_type == LEARNED_LINEAR) { model.m_hidden = 0; }
+
+    valid = valid && !traces.empty() && model.m_order >= 1 && model.m_order <= LEARNED_MAX_ORDER &&
+            (model.m_type == LEARNED_LINEAR || (model.m_hidden >= 1 && model.m_hidden <= LEARNED_MAX_HIDDEN)) &&
+            model.m_horizon > 0.0 && model.m_scale > 0.0 && epochs >= 1;
+    if (!valid)
+    {
+        printf("usage: ModelTrainer [-type linear|mlp] [-order <1..%d>] [-hidden <1..%d>] [-horizon <s>]\n",
+               LEARNED_MAX_ORDER, LEARNED_MAX_HIDDEN);
+        printf("                    [-epochs <n>] [-scale <m/s>] [-out <file>] <trace> ...\n");
+        return (1);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // EXAMPLES
+    //--------------------------------------------------------------------------
+
+    vector<vector<TraceSample> > samples;
+    size_t totalSamples = 0;
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        samples.push_back(vector<TraceSample>());
+        if (!loadTrace(traces[t].c_str(), samples.back()))
+        {
+            fprintf(stderr, "cannot read trace %s\n", traces[t].c_str());
+            samples.back().clear();
+        }
+        totalSamples += samples.back().size();
+    }
+
+    // sample period: median spacing of the first trace with samples
+    for (size_t t = 0; t < samples.size() && model.m_period == 0.0; t++)
+    {
+        vector<double> spacing;
+        for (size_t n = 1; n < samples[t].size() && n < 100000; n++)
+        {
+            spacing.push_back(samples[t][n].m_time - samples[t][n - 1].m_time);
+        }
+        if (spacing.empty()) { continue; }
+        nth_element(spacing.begin(), spacing.begin() + spacing.size() / 2, spacing.end());
+        model.m_period = spacing[spacing.size() / 2];
+    }
+    if (model.m_period <= 0.0)
+    {
+        fprintf(stderr, "no samples\n");
+        return (1);
+    }
+
+    int steps = (int)floor(model.m_horizon / model.m_period + 0.5);
+    size_t stride = (3 * totalSamples + MAX_EXAMPLES - 1) / MAX_EXAMPLES;
+    if (stride < 1) { stride = 1; }
+
+    ExampleSet training, validation;
+    training.m_numInputs = validation.m_numInputs = model.getNumInputs();
+    double targetScale = 1.0 / (model.m_horizon * model.m_scale);
+    for (size_t t = 0; t < samples.size(); t++)
+    {
+        const vector<TraceSample>& trace = samples[t];
+        size_t validationStart = (size_t)((1.0 - VALIDATION_FRACTION) * trace.size());
+
+        LearnedModelInputs<double, LANES_PER_DEVICE> inputs;
+        for (size_t n = 0; n + steps < trace.size(); n++)
+        {
+            LaneVector<double, LANES_PER_DEVICE> position, velocity;
+            position.load(trace[n].m_position);
+            velocity.load(trace[n].m_velocity);
+            inputs.push(position, velocity);
+            if (!inputs.isReady(model) || n % stride != 0) { continue; }
+
+            // examples straddling the split would leak the validation positions
+            if (n < validationStart && n + steps >= validationStart) { continue; }
+            ExampleSet& set = (n < validationStart) ? training : validation;
+
+            LaneVector<double, LANES_PER_DEVICE> values[LEARNED_MAX_INPUTS];
+            inputs.compute(model, values);
+            for (int i = 0; i < 3; i++)
+            {
+                for (int k = 0; k < model.getNumInputs(); k++) { set.m_inputs.push_back((float)values[k].m_value[i]); }
+                set.m_targets.push_back((float)((trace[n + steps].m_position[i] - trace[n].m_position[i]) * targetScale));
+            }
+        }
+    }
+
+    if (training.size() == 0 || validation.size() == 0)
+    {
+        fprintf(stderr, "traces too short for a %.3f s horizon\n", model.m_horizon);
+        return (1);
+    }
+    printf("%d traces, %zu samples at %.0f Hz, %zu training and %zu validation examples (every %zu)\n",
+           (int)traces.size(), totalSamples, 1.0 / model.m_period, training.size(), validation.size(), stride);
+
+
+    //--------------------------------------------------------------------------
+    // TRAINING
+    //--------------------------------------------------------------------------
+
+    // baseline: extrapolating the device velocity (the last input) unchanged
+    LearnedModel baseline = model;
+    baseline.m_type = LEARNED_LINEAR;
+    vector<double> baselineWeights(model.getNumInputs() + 1, 0.0);
+    baselineWeights[model.m_order] = 1.0;
+
+    vector<double> weights;
+    if (model.m_type == LEARNED_LINEAR)
+    {
+        trainLinear(model, training, weights);
+    }
+    else
+    {
+        trainMlp(model, training, validation, epochs, weights);
+    }
+    storeWeights(weights, model);
+
+    double toMillimeters = 1000.0 * model.m_horizon * model.m_scale;
+    printf("\nrmse at %.3f s [mm]        training   validation\n", model.m_horizon);
+    printf("device velocity          %9.3f    %9.3f\n", toMillimeters * rootMeanSquare(baseline, baselineWeights, training),
+           toMillimeters * rootMeanSquare(baseline, baselineWeights, validation));
+    printf("%-24s %9.3f    %9.3f\n", (model.m_type == LEARNED_MLP) ? "mlp" : "linear",
+           toMillimeters * rootMeanSquare(model, weights, training), toMillimeters * rootMeanSquare(model, weights, validation));
+
+
+    //--------------------------------------------------------------------------
+    // INFERENCE COST
+    //--------------------------------------------------------------------------
+
+    LearnedPredictor predictor;
+    predictor.setModel(model);
+    const vector<TraceSample>& trace = samples[0].empty() ? samples.back() : samples[0];
+    double total = 0.0, longest = 0.0;
+    for (size_t n = 0; n < trace.size(); n++)
+    {
+        MotionSample sample;
+        sample.m_time = trace[n].m_time;
+        for (int i = 0; i < 3; i++)
+        {
+            sample.m_position[i] = trace[n].m_position[i];
+            sample.m_velocity[i] = trace[n].m_velocity[i];
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        predictor.update(sample);
+        double cost = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        total += cost;
+        longest = max(longest, cost);
+    }
+    printf("\ninference: mean %.3f us, max %.3f us per sample (%d weights)\n",
+           1e6 * total / trace.size(), 1e6 * longest, model.getNumWeights());
+
+    if (!saveLearnedModel(output.c_str(), model))
+    {
+        fprintf(stderr, "cannot write %s\n", output.c_str());
+        return (1);
+    }
+    printf("wrote %s\n", output.c_str());
+    return (0);
+}
+
+//------------------------------------------------------------------------------
+
+bool loadTrace(const char* a_filename, vector<TraceSample>& a_samples)
+{
+    TraceReader reader;
+    if (!reader.open(a_filename)) { return false; }
+
+    TraceSample sample;
+    while (reader.next(sample))
+    {
+        a_samples.push_back(sample);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+double evaluate(const LearnedModel& a_model, const vector<double>& a_weights, const float* a_input, vector<double>* a_hidden)
+{
+    int inputs = a_model.getNumInputs();
+    if (a_model.m_type == LEARNED_LINEAR)
+    {
+        double y = a_weights[inputs];
+        for (int k = 0; k < inputs; k++) { y += a_weights[k] * a_input[k]; }
+        return y;
+    }
+
+    // layout: hidden weights, hidden biases, output weights, output bias
+    const double* hiddenWeight = &a_weights[0];
+    const double* hiddenBias = hiddenWeight + a_model.m_hidden * inputs;
+    const double* outputWeight = hiddenBias + a_model.m_hidden;
+    double y = outputWeight[a_model.m_hidden];
+    for (int j = 0; j < a_model.m_hidden; j++)
+    {
+        double h = hiddenBias[j];
+        for (int k = 0; k < inputs; k++) { h += hiddenWeight[j * inputs + k] * a_input[k]; }
+        h = (h > 0.0) ? h : 0.0;
+        if (a_hidden != NULL) { (*a_hidden)[j] = h; }
+        y += outputWeight[j] * h;
+    }
+    return y;
+}
+
+//------------------------------------------------------------------------------
+
+double rootMeanSquare(const LearnedModel& a_model, const vector<double>& a_weights, const ExampleSet& a_set)
+{
+    double sum = 0.0;
+    for (size_t n = 0; n < a_set.size(); n++)
+    {
+        double error = evaluate(a_model, a_weights, a_set.input(n), NULL) - a_set.m_targets[n];
+        sum += error * error;
+    }
+    return sqrt(sum / a_set.size());
+}
+
+//------------------------------------------------------------------------------
+
+void trainLinear(const LearnedModel& a_model, const ExampleSet& a_set, vector<double>& a_weights)
+{
+    // normal equations over the inputs and a constant 1
+    int size = a_model.getNumInputs() + 1;
+    vector<double> matrix(size * size, 0.0), vector(size, 0.0);
+    double x[LEARNED_MAX_INPUTS + 1];
+    for (size_t n = 0; n < a_set.size(); n++)
+    {
+        const float* input = a_set.input(n);
+        for (int k = 0; k < size - 1; k++) { x[k] = input[k]; }
+        x[size - 1] = 1.0;
+
+        for (int r = 0; r < size; r++)
+        {
+            for (int c = 0; c < size; c++) { matrix[r * size + c] += x[r] * x[c]; }
+            vector[r] += x[r] * a_set.m_targets[n];
+        }
+    }
+
+    double power = 0.0;
+    for (int k = 0; k < size - 1; k++) { power += matrix[k * size + k]; }
+    for (int k = 0; k < size - 1; k++) { matrix[k * size + k] += RIDGE * power / (size - 1); }
+
+    // Gaussian elimination with partial pivoting
+    for (int c = 0; c < size; c++)
+    {
+        int pivot = c;
+        for (int r = c + 1; r < size; r++)
+        {
+            if (fabs(matrix[r * size + c]) > fabs(matrix[pivot * size + c])) { pivot = r; }
+        }
+        for (int k = 0; k < size; k++) { swap(matrix[c * size + k], matrix[pivot * size + k]); }
+        swap(vector[c], vector[pivot]);
+
+        for (int r = c + 1; r < size; r++)
+        {
+            double factor = matrix[r * size + c] / matrix[c * size + c];
+            for (int k = c; k < size; k++) { matrix[r * size + k] -= factor * matrix[c * size + k]; }
+            vector[r] -= factor * vector[c];
+        }
+    }
+
+    a_weights.assign(size, 0.0);
+    for (int r = size - 1; r >= 0; r--)
+    {
+        double sum = vector[r];
+        for (int k = r + 1; k < size; k++) { sum -= matrix[r * size + k] * a_weights[k]; }
+        a_weights[r] = sum / matrix[r * size + r];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void trainMlp(const LearnedModel& a_model, const ExampleSet& a_training, const ExampleSet& a_validation,
+              int a_epochs, vector<double>& a_weights)
+{
+    int inputs = a_model.getNumInputs();
+    int hidden = a_model.m_hidden;
+    size_t count = (size_t)a_model.getNumWeights();
+
+    // He initialization of the hidden layer, small output layer
+    mt19937 random(1);
+    a_weights.assign(count, 0.0);
+    uniform_real_distribution<double> hiddenInit(-sqrt(6.0 / inputs), sqrt(6.0 / inputs));
+    uniform_real_distribution<double> outputInit(-sqrt(1.0 / hidden), sqrt(1.0 / hidden));
+    for (int n = 0; n < hidden * inputs; n++) { a_weights[n] = hiddenInit(random); }
+    for (int j = 0; j < hidden; j++) { a_weights[hidden * inputs + hidden + j] = outputInit(random); }
+
+    vector<double> gradient(count), moment1(count, 0.0), moment2(count, 0.0), activation(hidden);
+    vector<size_t> order(a_training.size());
+    for (size_t n = 0; n < order.size(); n++) { order[n] = n; }
+
+    double toMillimeters = 1000.0 * a_model.m_horizon * a_model.m_scale;
+    long long step = 0;
+    for (int epoch = 0; epoch < a_epochs; epoch++)
+    {
+        shuffle(order.begin(), order.end(), random);
+
+        for (size_t begin = 0; begin < order.size(); begin += BATCH_SIZE)
+        {
+            size_t end = min(begin + BATCH_SIZE, order.size());
+            fill(gradient.begin(), gradient.end(), 0.0);
+
+            // gradient of the mean squared error over the batch
+            for (size_t b = begin; b < end; b++)
+            {
+                const float* input = a_training.input(order[b]);
+                double error = evaluate(a_model, a_weights, input, &activation) - a_training.m_targets[order[b]];
+                double scale = 2.0 * error / (end - begin);
+
+                double* hiddenWeight = &gradient[0];
+                double* hiddenBias = hiddenWeight + hidden * inputs;
+                double* outputWeight = hiddenBias + hidden;
+                const double* outputValue = &a_weights[hidden * inputs + hidden];
+                for (int j = 0; j < hidden; j++)
+                {
+                    outputWeight[j] += scale * activation[j];
+                    if (activation[j] <= 0.0) { continue; }
+                    double back = scale * outputValue[j];
+                    hiddenBias[j] += back;
+                    for (int k = 0; k < inputs; k++) { hiddenWeight[j * inputs + k] += back * input[k]; }
+                }
+                outputWeight[hidden] += scale;
+            }
+
+            // Adam step
+            step++;
+            double correction1 = 1.0 - pow(ADAM_BETA1, (double)step);
+            double correction2 = 1.0 - pow(ADAM_BETA2, (double)step);
+            for (size_t n = 0; n < count; n++)
+            {
+                moment1[n] = ADAM_BETA1 * moment1[n] + (1.0 - ADAM_BETA1) * gradient[n];
+                moment2[n] = ADAM_BETA2 * moment2[n] + (1.0 - ADAM_BETA2) * gradient[n] * gradient[n];
+                a_weights[n] -= LEARNING_RATE * (moment1[n] / correction1) / (sqrt(moment2[n] / correction2) + ADAM_EPSILON);
+            }
+        }
+
+        printf("epoch %3d: rmse %.3f mm training, %.3f mm validation\n", epoch + 1,
+               toMillimeters * rootMeanSquare(a_model, a_weights, a_training),
+               toMillimeters * rootMeanSquare(a_model, a_weights, a_validation));
+        fflush(stdout);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void storeWeights(const vector<double>& a_weights, LearnedModel& a_model)
+{
+    int inputs = a_model.getNumInputs();
+    size_t next = 0;
+    if (a_model.m_type == LEARNED_MLP)
+    {
+        for (int j = 0; j < a_model.m_hidden; j++)
+        {
+            for (int k = 0; k < inputs; k++) { a_model.m_hiddenWeight[j][k] = (float)a_weights[next++]; }
+        }
+        for (int j = 0; j < a_model.m_hidden; j++) { a_model.m_hiddenBias[j] = (float)a_weights[next++]; }
+    }
+    int outputs = (a_model.m_type == LEARNED_MLP) ? a_model.m_hidden : inputs;
+    for (int j = 0; j < outputs; j++) { a_model.m_outputWeight[j] = (float)a_weights[next++]; }
+    a_model.m_outputBias = (float)a_weights[next++];
+}
+
+//------------------------------------------------------------------------------
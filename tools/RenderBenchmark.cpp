@@ -0,0 +1,304 @@
+//==============================================================================
+/*
+    RenderBenchmark.cpp
+
+    Headless benchmark of the visualization path of the threshold program.
+
+    RenderBenchmark [-frames <n>] [-size <w> <h>] [-trails] [-scope] [-csv <file>] <trace>
+
+    The scene of the program (cursor, prediction indicator, velocity line,
+    HUD labels and optionally the trails and the velocity scope) is rendered
+    into an offscreen frame buffer on Mesa's software rasterizer (OSMesa),
+    so no GPU or display is needed. The trace is replayed at SCENE_RATE: the
+    samples of each frame period drive the threshold predictor and feed the
+    trails and the scope, then the frame is rendered. Only the render
+    (updateShadowMaps, renderView, glFinish) is timed; the distribution of
+    frame times is printed and, with -csv, every frame time is written out.
+
+    Unlike the other tools this one needs CHAI3D, built with GLEW for OSMesa
+    (GLEW_OSMESA). From the repository root:
+        g++ -std=c++11 -O2 -I. -I<chai3d>/src -I<chai3d>/external/Eigen -I<chai3d>/external/glew/include
+            -DGLEW_OSMESA tools/RenderBenchmark.cpp -o RenderBenchmark -L<chai3d>/lib -lchai3d -lOSMesa -lpthread
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "GL/osmesa.h"
+#include "graphics/SceneSettings.h"
+#include "graphics/ScopePlot.h"
+#include "graphics/TrailMesh.h"
+#include "prediction/Predictors.h"
+#include "prediction/TraceReader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+void printUsage()
+{
+    printf("usage: RenderBenchmark [-frames <n>] [-size <w> <h>] [-trails] [-scope] [-csv <file>] <trace>\n");
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    int numFrames = 1000;
+    int width = 1024;
+    int height = 768;
+    bool useTrails = false;
+    bool useScope = false;
+    const char* csvFile = NULL;
+    const char* traceFile = NULL;
+
+    for (int n = 1; n < argc; n++)
+    {
+        if (strcmp(argv[n], "-frames") == 0 && n + 1 < argc) { numFrames = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-size") == 0 && n + 2 < argc) { width = atoi(argv[++n]); height = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-trails") == 0) { useTrails = true; }
+        else if (strcmp(argv[n], "-scope") == 0) { useScope = true; }
+        else if (strcmp(argv[n], "-csv") == 0 && n + 1 < argc) { csvFile = argv[++n]; }
+        else { traceFile = argv[n]; }
+    }
+
+    if (traceFile == NULL || numFrames < 1 || width < 1 || height < 1)
+    {
+        printUsage();
+        return (1);
+    }
+
+    TraceReader reader;
+    if (!reader.open(traceFile))
+    {
+        fprintf(stderr, "cannot read trace %s\n", traceFile);
+        return (1);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // OFFSCREEN CONTEXT
+    //--------------------------------------------------------------------------
+
+    // the window system buffer is only needed to make the context current;
+    // the scene is drawn into the frame buffer object of cFrameBuffer
+    OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+    vector<unsigned char> windowBuffer(4 * width * height);
+    if (context == NULL || !OSMesaMakeCurrent(context, &windowBuffer[0], GL_UNSIGNED_BYTE, width, height))
+    {
+        fprintf(stderr, "cannot create an OSMesa context\n");
+        return (1);
+    }
+
+#ifdef GLEW_VERSION
+    glewInit();
+#endif
+
+
+    //--------------------------------------------------------------------------
+    // SCENE (as in the threshold program)
+    //--------------------------------------------------------------------------
+
+    cWorld* world = new cWorld();
+    world->m_backgroundColor.setBlack();
+
+    cCamera* camera = new cCamera(world);
+    world->addChild(camera);
+    camera->set(cVector3d(0.5, 0.0, 0.0), cVector3d(0.0, 0.0, 0.0), cVector3d(0.0, 0.0, 1.0));
+    camera->setClippingPlanes(0.01, 10.0);
+
+    cDirectionalLight* light = new cDirectionalLight(world);
+    world->addChild(light);
+    light->setEnabled(true);
+    light->setDir(-1.0, 0.0, 0.0);
+
+    cShapeSphere* cursor = new cShapeSphere(0.01);
+    cShapeSphere* predictIndicator = new cShapeSphere(0.005);
+    world->addChild(cursor);
+    world->addChild(predictIndicator);
+    cursor->setShowFrame(true);
+    cursor->setFrameSize(0.05);
+
+    cShapeLine* velocity = new cShapeLine(cVector3d(0,0,0), cVector3d(0,0,0));
+    world->addChild(velocity);
+
+    TrailMesh<TRAIL_POINTS>* actualTrail = new TrailMesh<TRAIL_POINTS>(cColorf(0.25f, 0.41f, 0.88f));
+    TrailMesh<TRAIL_POINTS>* predictedTrail = new TrailMesh<TRAIL_POINTS>(cColorf(1.0f, 0.84f, 0.0f));
+    world->addChild(actualTrail);
+    world->addChild(predictedTrail);
+    actualTrail->setShowEnabled(useTrails);
+    predictedTrail->setShowEnabled(useTrails);
+
+    // the program shows up to seven HUD labels
+    cFont* font = NEW_CFONTCALIBRI20();
+    vector<cLabel*> labels;
+    for (int n = 0; n < 7; n++)
+    {
+        cLabel* label = new cLabel(font);
+        label->setText("0.000 / 0.000 / 0.000  benchmark label");
+        label->setLocalPos(20, height - 20 * (n + 2), 0);
+        camera->m_frontLayer->addChild(label);
+        labels.push_back(label);
+    }
+
+    ScopePlot<6, SCOPE_HISTORY>* velocityScope = new ScopePlot<6, SCOPE_HISTORY>(2.0 * DEFAULT_VELOCITY_LIMIT);
+    for (int c = 1; c < 6; c++)
+    {
+        velocityScope->setChannelShown(c, c == 3);
+    }
+    velocityScope->setLocalPos(20, 20, 0);
+    velocityScope->setSize(width - 40, 120);
+    velocityScope->setShowEnabled(useScope);
+    camera->m_frontLayer->addChild(velocityScope);
+
+    cFrameBufferPtr frameBuffer = cFrameBuffer::create();
+    if (!frameBuffer->setup(camera, width, height, true, true))
+    {
+        fprintf(stderr, "cannot create a %d x %d frame buffer\n", width, height);
+        return (1);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // REPLAY
+    //--------------------------------------------------------------------------
+
+    ThresholdPredictor predictor;
+    TraceSample sample;
+    if (!reader.next(sample))
+    {
+        fprintf(stderr, "trace %s is empty\n", traceFile);
+        return (1);
+    }
+    double frameTime = sample.m_time;
+    bool more = true;
+    cVector3d position, predictedPosition, linearVelocity;
+    cMatrix3d rotation;
+    rotation.identity();
+
+    vector<double> durations;
+    durations.reserve(numFrames);
+    while ((int)durations.size() < numFrames)
+    {
+        // advance the scene by one frame period of the trace (rewinding at its end)
+        frameTime += 1.0 / SCENE_RATE;
+        while (more && sample.m_time < frameTime)
+        {
+            MotionSample motion;
+            motion.m_time = sample.m_time;
+            MotionPrediction prediction;
+            for (int i = 0; i < 3; i++)
+            {
+                motion.m_position[i] = sample.m_position[i];
+                motion.m_velocity[i] = sample.m_velocity[i];
+            }
+            predictor.update(motion);
+            predictor.predict(PREDICTION_HORIZON, prediction);
+
+            position.set(sample.m_position[0], sample.m_position[1], sample.m_position[2]);
+            predictedPosition.set(prediction.m_position[0], prediction.m_position[1], prediction.m_position[2]);
+            linearVelocity.set(prediction.m_velocity[0], prediction.m_velocity[1], prediction.m_velocity[2]);
+            for (int i = 0; i < 3; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    rotation(i, j) = sample.m_rotation[3 * i + j];
+                }
+            }
+
+            if (useTrails)
+            {
+                actualTrail->push(position);
+                predictedTrail->push(predictedPosition);
+            }
+            if (useScope)
+            {
+                float velocities[6];
+                for (int i = 0; i < 3; i++)
+                {
+                    velocities[i] = (float)sample.m_velocity[i];
+                    velocities[3 + i] = (float)prediction.m_velocity[i];
+                }
+                velocityScope->push(velocities);
+            }
+
+            more = reader.next(sample);
+        }
+        if (!more)
+        {
+            reader.rewind();
+            predictor.reset();
+            more = reader.next(sample);
+            frameTime = sample.m_time;
+        }
+
+        cursor->setLocalPos(position);
+        cursor->setLocalRot(rotation);
+        predictIndicator->setLocalPos(predictedPosition);
+        velocity->m_pointA = position;
+        velocity->m_pointB = cAdd(position, linearVelocity);
+
+        // time the render as the program's graphics thread performs it
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        world->updateShadowMaps(false, false);
+        frameBuffer->renderView();
+        glFinish();
+        durations.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+
+    //--------------------------------------------------------------------------
+    // REPORT
+    //--------------------------------------------------------------------------
+
+    if (csvFile != NULL)
+    {
+        FILE* file = fopen(csvFile, "w");
+        if (file == NULL)
+        {
+            fprintf(stderr, "cannot write %s\n", csvFile);
+        }
+        else
+        {
+            fprintf(file, "frame,seconds\n");
+            for (size_t n = 0; n < durations.size(); n++)
+            {
+                fprintf(file, "%u,%.9f\n", (unsigned int)n, durations[n]);
+            }
+            fclose(file);
+        }
+    }
+
+    double total = 0.0;
+    for (size_t n = 0; n < durations.size(); n++)
+    {
+        total += durations[n];
+    }
+    vector<double> sorted(durations);
+    sort(sorted.begin(), sorted.end());
+    const double quantiles[5] = { 0.5, 0.9, 0.95, 0.99, 0.999 };
+
+    printf("%s: %d frames of %d x %d, trails %s, scope %s\n", traceFile, numFrames, width, height,
+           useTrails ? "on" : "off", useScope ? "on" : "off");
+    printf("renderer %s\n\n", (const char*)glGetString(GL_RENDERER));
+    printf("frame time [ms]  mean %.3f  min %.3f", 1000.0 * total / sorted.size(), 1000.0 * sorted.front());
+    for (int q = 0; q < 5; q++)
+    {
+        size_t rank = (size_t)(quantiles[q] * (sorted.size() - 1) + 0.5);
+        printf("  p%g %.3f", 100.0 * quantiles[q], 1000.0 * sorted[rank]);
+    }
+    printf("  max %.3f\n", 1000.0 * sorted.back());
+    printf("%.1f frames/s, %.1f%% of the %.1f ms frame period at the mean\n", sorted.size() / total,
+           100.0 * total / sorted.size() * SCENE_RATE, 1000.0 / SCENE_RATE);
+
+    OSMesaDestroyContext(context);
+    return (0);
+}
+
+//------------------------------------------------------------------------------
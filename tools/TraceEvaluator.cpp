@@ -0,0 +1,415 @@
+//==============================================================================
+/*
+    TraceEvaluator.cpp
+
+    Offline evaluation of a predictor over many recorded traces.
+
+    TraceEvaluator [-predictor <name>] [-horizon <s>] [-threads <n>]
+                   [-model <file>] [-adaptive] <trace> ...
+
+    predictor: threshold (default), running-average, savitzky-golay,
+               alpha-beta-gamma, rls-ar, ensemble-best, ensemble-blend, learned
+               (the model written by ModelTrainer, given with -model)
+    horizon:   1 s by default; for learned the horizon the model was trained
+               for, which an explicit -horizon must match
+    adaptive:  adaptive jitter and stop thresholds in the threshold predictor
+               (also the ensemble member), as key 4 of the threshold program
+
+    Every trace is cut into units of UNIT_CHUNKS chunks that are evaluated
+    independently on a work-stealing thread pool. A unit replays the chunk
+    before it without scoring to warm up the predictor, scores every
+    prediction made from its own samples and reads past its end until the
+    last prediction has reached its target time. Each unit starts from a
+    fresh predictor and writes its statistics to its own slot; the slots are
+    merged in trace and unit order, so the result does not depend on the
+    number of threads or on which thread ran which unit.
+
+    Build from the repository root:
+        g++ -std=c++11 -O2 -I. tools/TraceEvaluator.cpp -o TraceEvaluator -pthread
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/AlphaBetaGammaPredictor.h"
+#include "prediction/EnsemblePredictor.h"
+#include "prediction/LearnedPredictor.h"
+#include "prediction/PredictionErrorTracker.h"
+#include "prediction/RlsArPredictor.h"
+#include "prediction/Predictors.h"
+#include "prediction/TraceReader.h"
+#include "tools/WorkStealingPool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// GENERAL SETTINGS
+//------------------------------------------------------------------------------
+
+// chunks scored per unit of work (about 16 s at 1 kHz)
+const int UNIT_CHUNKS = 16;
+
+// chunks replayed before a unit to warm up the predictor
+const int WARMUP_CHUNKS = 1;
+
+// pending predictions per unit (4 s horizon at 1 kHz)
+const int QUEUE_CAPACITY = 4096;
+
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// all predictors, so any of them can be selected by name
+struct PredictorSet
+{
+    ThresholdPredictor m_threshold;
+    RunningAveragePredictor m_runningAverage;
+    SavitzkyGolayPredictor m_savitzkyGolay;
+    AlphaBetaGammaPredictor m_alphaBetaGamma;
+    RlsArPredictor m_rlsAr;
+    LearnedPredictor m_learned;
+    EnsemblePredictor m_ensemble;
+
+    // the ensemble runs the threshold, running average and Savitzky-Golay predictors,
+    // as in the threshold program
+    PredictorSet(double a_horizon) : m_ensemble(a_horizon)
+    {
+        m_ensemble.addMember(&m_threshold);
+        m_ensemble.addMember(&m_runningAverage);
+        m_ensemble.addMember(&m_savitzkyGolay);
+    }
+
+    // predictor called a_name, NULL if unknown
+    MotionPredictor* select(const string& a_name)
+    {
+        if (a_name == "threshold") { return &m_threshold; }
+        if (a_name == "running-average") { return &m_runningAverage; }
+        if (a_name == "savitzky-golay") { return &m_savitzkyGolay; }
+        if (a_name == "alpha-beta-gamma") { return &m_alphaBetaGamma; }
+        if (a_name == "rls-ar") { return &m_rlsAr; }
+        if (a_name == "learned") { return &m_learned; }
+        if (a_name == "ensemble-best") { m_ensemble.setMode(EnsemblePredictor::ENSEMBLE_SELECT_BEST); return &m_ensemble; }
+        if (a_name == "ensemble-blend") { m_ensemble.setMode(EnsemblePredictor::ENSEMBLE_BLEND); return &m_ensemble; }
+        return NULL;
+    }
+};
+
+// a range of chunks of one trace
+struct Unit
+{
+    int m_trace;
+    int m_firstChunk;
+    int m_lastChunk;            // exclusive
+};
+
+// result slot of a unit
+struct UnitResult
+{
+    PredictionErrorStatistics m_statistics;
+    unsigned long long m_samples;
+    unsigned long long m_dropped;
+    bool m_failed;
+};
+
+// state of one worker thread
+struct Worker
+{
+    Worker(double a_horizon) : m_predictors(a_horizon), m_trace(-1) {}
+
+    // the predictors hold lane vectors aligned beyond what new guarantees in C++11
+    static void* operator new(size_t a_size) { return allocateAligned(a_size, alignof(Worker)); }
+    static void operator delete(void* a_memory) { freeAligned(a_memory); }
+
+    PredictorSet m_predictors;
+    PredictionErrorTracker<QUEUE_CAPACITY> m_tracker;
+    TraceReader m_reader;
+    int m_trace;                // trace currently open in m_reader
+    vector<TraceSample> m_chunk;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//------------------------------------------------------------------------------
+
+// evaluate one unit
+void evaluateUnit(const Unit& a_unit, const vector<string>& a_traces, const string& a_predictor,
+                  double a_horizon, Worker& a_worker, UnitResult& a_result);
+
+// print one line of results
+void printResult(const char* a_name, const PredictionErrorStatistics& a_statistics, unsigned long long a_samples);
+
+
+//==============================================================================
+
+int main(int argc, char* argv[])
+{
+    string predictorName = "threshold";
+    double horizon = 1.0;
+    bool horizonGiven = false;
+    int numThreads = 0;
+    bool adaptive = false;
+    string modelName;
+    vector<string> traces;
+
+    for (int n = 1; n < argc; n++)
+    {
+        if (strcmp(argv[n], "-predictor") == 0 && n + 1 < argc) { predictorName = argv[++n]; }
+        else if (strcmp(argv[n], "-horizon") == 0 && n + 1 < argc) { horizon = atof(argv[++n]); horizonGiven = true; }
+        else if (strcmp(argv[n], "-threads") == 0 && n + 1 < argc) { numThreads = atoi(argv[++n]); }
+        else if (strcmp(argv[n], "-model") == 0 && n + 1 < argc) { modelName = argv[++n]; }
+        else if (strcmp(argv[n], "-adaptive") == 0) { adaptive = true; }
+        else { traces.push_back(argv[n]); }
+    }
+
+    const char* predictorNames[] = { "threshold", "running-average", "savitzky-golay", "alpha-beta-gamma", "rls-ar", "ensemble-best", "ensemble-blend",
+                                     "learned" };
+    bool known = false;
+    for (int n = 0; n < 8; n++)
+    {
+        known = known || (predictorName == predictorNames[n]);
+    }
+
+    if (traces.empty() || !known || horizon <= 0.0 || (predictorName == "learned") == modelName.empty())
+    {
+        printf("usage: TraceEvaluator [-predictor <name>] [-horizon <s>] [-threads <n>] [-model <file>] [-adaptive] <trace> ...\n");
+        printf("predictors: threshold, running-average, savitzky-golay, alpha-beta-gamma, rls-ar, ensemble-best, ensemble-blend,\n");
+        printf("            learned (requires -model)\n");
+        return (1);
+    }
+
+    LearnedModel model;
+    string error;
+    if (!modelName.empty() && !loadLearnedModel(modelName.c_str(), model, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return (1);
+    }
+
+    // the model outputs the mean velocity over its own horizon, so it only predicts at that one
+    if (predictorName == "learned")
+    {
+        if (!horizonGiven) { horizon = model.m_horizon; }
+        else if (fabs(horizon / model.m_horizon - 1.0) > 0.05)
+        {
+            fprintf(stderr, "%s was trained for a %.3f s horizon, not %.3f s\n", modelName.c_str(), model.m_horizon, horizon);
+            return (1);
+        }
+    }
+
+
+    //--------------------------------------------------------------------------
+    // SHARDING
+    //--------------------------------------------------------------------------
+
+    vector<Unit> units;
+    vector<int> firstUnit(traces.size() + 1);
+    double recordedTime = 0.0;
+    unsigned long long recordedPeriods = 0;
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        firstUnit[t] = (int)units.size();
+
+        TraceReader reader;
+        if (!reader.open(traces[t].c_str()))
+        {
+            fprintf(stderr, "cannot read trace %s\n", traces[t].c_str());
+            continue;
+        }
+
+        for (int c = 0; c < reader.getNumChunks(); c += UNIT_CHUNKS)
+        {
+            Unit unit;
+            unit.m_trace = (int)t;
+            unit.m_firstChunk = c;
+            unit.m_lastChunk = (c + UNIT_CHUNKS < reader.getNumChunks()) ? c + UNIT_CHUNKS : reader.getNumChunks();
+            units.push_back(unit);
+        }
+
+        // duration and sample periods of the recording, for its mean sample period
+        unsigned long long count = 0;
+        for (int c = 0; c < reader.getNumChunks(); c++) { count += reader.getChunkInfo(c).m_count; }
+        if (count > 1)
+        {
+            recordedTime += reader.getChunkInfo(reader.getNumChunks() - 1).m_endTime - reader.getChunkInfo(0).m_startTime;
+            recordedPeriods += count - 1;
+        }
+    }
+    firstUnit[traces.size()] = (int)units.size();
+
+
+    //--------------------------------------------------------------------------
+    // EVALUATION
+    //--------------------------------------------------------------------------
+
+    WorkStealingPool pool(numThreads);
+    vector<Worker*> workers;
+    for (int w = 0; w < pool.getNumThreads(); w++)
+    {
+        workers.push_back(new Worker(horizon));
+        if (!modelName.empty()) { workers.back()->m_predictors.m_learned.setModel(model); }
+        workers.back()->m_predictors.m_threshold.setUseAdaptiveThreshold(adaptive);
+    }
+    vector<UnitResult> results(units.size());
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    pool.run((int)units.size(), [&](int a_unit, int a_worker)
+    {
+        evaluateUnit(units[a_unit], traces, predictorName, horizon, *workers[a_worker], results[a_unit]);
+    });
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+
+    //--------------------------------------------------------------------------
+    // RESULTS
+    //--------------------------------------------------------------------------
+
+    printf("predictor %s%s, horizon %.3f s\n\n", predictorName.c_str(), adaptive ? " (adaptive thresholds)" : "", horizon);
+    printf("%-32s %10s   %-26s %-26s %-26s\n", "trace", "samples", "rmse x/y/z [mm]", "p95 x/y/z [mm]", "max x/y/z [mm]");
+
+    PredictionErrorStatistics total;
+    unsigned long long totalSamples = 0;
+    unsigned long long totalDropped = 0;
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        PredictionErrorStatistics statistics;
+        unsigned long long samples = 0;
+        bool failed = false;
+        for (int u = firstUnit[t]; u < firstUnit[t + 1]; u++)
+        {
+            statistics.merge(results[u].m_statistics);
+            samples += results[u].m_samples;
+            totalDropped += results[u].m_dropped;
+            failed = failed || results[u].m_failed;
+        }
+
+        printResult(traces[t].c_str(), statistics, samples);
+        if (failed) { printf("    (corrupt chunks skipped)\n"); }
+
+        total.merge(statistics);
+        totalSamples += samples;
+    }
+
+    printf("\n");
+    printResult("all", total, totalSamples);
+    if (totalDropped > 0) { printf("%llu predictions dropped (horizon too long for the queue)\n", totalDropped); }
+
+    // noise the tracker passes on at the gains of the mean sample period of the traces
+    // (not those a worker was left with, which depend on the units it happened to run)
+    if (predictorName == "alpha-beta-gamma" && recordedPeriods > 0 && recordedTime > 0.0)
+    {
+        AlphaBetaGammaPredictor tracker;
+        MotionSample sample = MotionSample();
+        tracker.update(sample);
+        sample.m_time = recordedTime / (double)recordedPeriods;
+        tracker.update(sample);
+
+        double position, velocity;
+        tracker.getNoiseRatios(position, velocity);
+        printf("tracker memory %.3f s: alpha %.3g, beta %.3g, gamma %.3g; noise passed on %.2f (position), %.1f m/s per m (velocity)\n",
+               tracker.getMemory(), tracker.getAlpha(), tracker.getBeta(), tracker.getGamma(), position, velocity);
+    }
+
+    printf("\n%d units on %d threads (%llu stolen) in %.3f s, %.1f M samples/s\n",
+           (int)units.size(), pool.getNumThreads(), pool.getStolen(), elapsed, 1e-6 * totalSamples / elapsed);
+
+    for (size_t w = 0; w < workers.size(); w++)
+    {
+        delete workers[w];
+    }
+    return (0);
+}
+
+//------------------------------------------------------------------------------
+
+void evaluateUnit(const Unit& a_unit, const vector<string>& a_traces, const string& a_predictor,
+                  double a_horizon, Worker& a_worker, UnitResult& a_result)
+{
+    a_result.m_statistics.reset();
+    a_result.m_samples = 0;
+    a_result.m_dropped = 0;
+    a_result.m_failed = false;
+
+    // keep the trace open while consecutive units come from it
+    if (a_worker.m_trace != a_unit.m_trace)
+    {
+        a_worker.m_trace = -1;
+        if (!a_worker.m_reader.open(a_traces[a_unit.m_trace].c_str()))
+        {
+            a_result.m_failed = true;
+            return;
+        }
+        a_worker.m_trace = a_unit.m_trace;
+    }
+    TraceReader& reader = a_worker.m_reader;
+
+    MotionPredictor* predictor = a_worker.m_predictors.select(a_predictor);
+    predictor->reset();
+    a_worker.m_tracker.reset();
+
+    int first = (a_unit.m_firstChunk > WARMUP_CHUNKS) ? a_unit.m_firstChunk - WARMUP_CHUNKS : 0;
+    double scoredEnd = reader.getChunkInfo(a_unit.m_lastChunk - 1).m_endTime;
+
+    for (int c = first; c < reader.getNumChunks(); c++)
+    {
+        // past the unit: only read on until the last prediction has matured
+        bool scored = (c >= a_unit.m_firstChunk && c < a_unit.m_lastChunk);
+        if (c >= a_unit.m_lastChunk && reader.getChunkInfo(c - 1).m_endTime >= scoredEnd + a_horizon) { break; }
+
+        if (!reader.readChunk(c, a_worker.m_chunk))
+        {
+            a_result.m_failed = true;
+            break;
+        }
+
+        for (size_t n = 0; n < a_worker.m_chunk.size(); n++)
+        {
+            const TraceSample& trace = a_worker.m_chunk[n];
+
+            MotionSample sample;
+            sample.m_time = trace.m_time;
+            for (int i = 0; i < 3; i++)
+            {
+                sample.m_position[i] = trace.m_position[i];
+                sample.m_velocity[i] = trace.m_velocity[i];
+            }
+
+            predictor->update(sample);
+            a_worker.m_tracker.update(sample.m_time, sample.m_position);
+
+            if (scored)
+            {
+                MotionPrediction prediction;
+                predictor->predict(a_horizon, prediction);
+                a_worker.m_tracker.push(sample.m_time + a_horizon, prediction.m_position);
+                a_result.m_samples++;
+            }
+        }
+    }
+
+    a_result.m_statistics = a_worker.m_tracker.getStatistics();
+    a_result.m_dropped = a_worker.m_tracker.getDropped();
+}
+
+//------------------------------------------------------------------------------
+
+void printResult(const char* a_name, const PredictionErrorStatistics& a_statistics, unsigned long long a_samples)
+{
+    PredictionErrorSummary summary;
+    a_statistics.summarize(summary);
+
+    char rmse[64], p95[64], max[64];
+    sprintf(rmse, "%.2f / %.2f / %.2f", 1000.0 * summary.m_rmse[0], 1000.0 * summary.m_rmse[1], 1000.0 * summary.m_rmse[2]);
+    sprintf(p95, "%.2f / %.2f / %.2f", 1000.0 * summary.m_p95[0], 1000.0 * summary.m_p95[1], 1000.0 * summary.m_p95[2]);
+    sprintf(max, "%.2f / %.2f / %.2f", 1000.0 * summary.m_max[0], 1000.0 * summary.m_max[1], 1000.0 * summary.m_max[2]);
+
+    printf("%-32s %10llu   %-26s %-26s %-26s\n", a_name, a_samples, rmse, p95, max);
+}
@@ -0,0 +1,111 @@
+//==============================================================================
+/*
+    TraceInspect.cpp
+
+    Command line inspection of recorded traces.
+
+    TraceInspect <trace>                    summary and chunk table
+    TraceInspect <trace> -events            only chunks with button events
+    TraceInspect <trace> -speed <v>         only chunks reaching a speed [m/s]
+    TraceInspect <trace> -range <t0> <t1>   samples between two times [s] as CSV
+
+    Chunk selection uses the index only; a time range seeks to its first
+    chunk and decodes only the chunks it covers.
+
+    Build from the repository root:
+        g++ -std=c++11 -O2 -I. tools/TraceInspect.cpp -o TraceInspect
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "prediction/TraceReader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+//------------------------------------------------------------------------------
+
+void printUsage()
+{
+    printf("usage: TraceInspect <trace> [-events | -speed <m/s> | -range <t0> <t1>]\n");
+}
+
+//------------------------------------------------------------------------------
+
+void printChunks(const TraceReader& a_reader, bool a_eventsOnly, double a_minSpeed)
+{
+    printf("chunk  offset      samples  start [s]   end [s]     speed [m/s]        button events\n");
+    for (int n = 0; n < a_reader.getNumChunks(); n++)
+    {
+        const TraceChunkInfo& info = a_reader.getChunkInfo(n);
+        if (a_eventsOnly && info.m_buttonEvents == 0) { continue; }
+        if (info.m_maxSpeed < a_minSpeed) { continue; }
+
+        printf("%5d  %-10llu  %7u  %-10.3f  %-10.3f  %.4f - %.4f    %u\n", n, info.m_offset, info.m_count,
+               info.m_startTime, info.m_endTime, info.m_minSpeed, info.m_maxSpeed, info.m_buttonEvents);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void printRange(TraceReader& a_reader, double a_start, double a_end)
+{
+    printf("time,x,y,z,vx,vy,vz,gripper,buttons\n");
+    if (!a_reader.seek(a_start)) { return; }
+
+    TraceSample sample;
+    while (a_reader.next(sample) && sample.m_time <= a_end)
+    {
+        printf("%.6f,%.5f,%.5f,%.5f,%.4f,%.4f,%.4f,%.4f,%u\n", sample.m_time,
+               sample.m_position[0], sample.m_position[1], sample.m_position[2],
+               sample.m_velocity[0], sample.m_velocity[1], sample.m_velocity[2],
+               sample.m_gripperAngle, sample.m_buttons);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return (1);
+    }
+
+    TraceReader reader;
+    if (!reader.open(argv[1]))
+    {
+        fprintf(stderr, "cannot read trace %s\n", argv[1]);
+        return (1);
+    }
+
+    if (argc == 2 || (argc == 3 && strcmp(argv[2], "-events") == 0) || (argc == 4 && strcmp(argv[2], "-speed") == 0))
+    {
+        unsigned long long samples = 0, events = 0;
+        for (int n = 0; n < reader.getNumChunks(); n++)
+        {
+            samples += reader.getChunkInfo(n).m_count;
+            events += reader.getChunkInfo(n).m_buttonEvents;
+        }
+
+        printf("%s: %d chunks, %llu samples, %llu button events", argv[1], reader.getNumChunks(), samples, events);
+        if (reader.getNumChunks() > 0)
+        {
+            printf(", %.3f s to %.3f s", reader.getChunkInfo(0).m_startTime,
+                   reader.getChunkInfo(reader.getNumChunks() - 1).m_endTime);
+        }
+        printf("%s\n\n", reader.isRecovered() ? " (index rebuilt, recording was interrupted)" : "");
+
+        printChunks(reader, (argc == 3), (argc == 4) ? atof(argv[3]) : 0.0);
+        return (0);
+    }
+
+    if (argc == 5 && strcmp(argv[2], "-range") == 0)
+    {
+        printRange(reader, atof(argv[3]), atof(argv[4]));
+        return (0);
+    }
+
+    printUsage();
+    return (1);
+}
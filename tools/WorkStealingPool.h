@@ -0,0 +1,122 @@
+//==============================================================================
+/*
+    WorkStealingPool.h
+
+    Runs a fixed set of independent tasks on a group of threads.
+
+    Tasks are numbered 0..n-1 and dealt out to the workers in contiguous
+    ranges, so neighbouring tasks (chunks of the same trace) stay on the
+    same thread. A worker takes tasks from the front of its own queue; once
+    it runs dry it steals from the back of another worker's queue, which
+    keeps all cores busy when tasks have uneven cost. Queues are guarded by
+    one mutex each; a queue operation is negligible next to a task.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef WorkStealingPoolH
+#define WorkStealingPoolH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+class WorkStealingPool
+{
+public:
+
+    // a_numThreads workers (0: one per hardware thread)
+    WorkStealingPool(int a_numThreads = 0)
+    {
+        m_numThreads = (a_numThreads > 0) ? a_numThreads : (int)std::thread::hardware_concurrency();
+        if (m_numThreads < 1) { m_numThreads = 1; }
+        m_stolen.store(0);
+    }
+
+    int getNumThreads() const { return m_numThreads; }
+
+    // tasks taken from another worker's queue during the last run
+    unsigned long long getStolen() const { return m_stolen.load(); }
+
+    // call a_task(task, worker) for every task in [0, a_numTasks) and wait for all of them
+    template <typename TASK>
+    void run(int a_numTasks, TASK a_task)
+    {
+        std::vector<Queue> queues(m_numThreads);
+        for (int w = 0; w < m_numThreads; w++)
+        {
+            int first = (int)((long long)a_numTasks * w / m_numThreads);
+            int last = (int)((long long)a_numTasks * (w + 1) / m_numThreads);
+            for (int t = first; t < last; t++) { queues[w].m_tasks.push_back(t); }
+        }
+        m_stolen.store(0);
+
+        std::vector<std::thread> threads;
+        for (int w = 1; w < m_numThreads; w++)
+        {
+            threads.push_back(std::thread(&WorkStealingPool::work<TASK>, this, w, &queues, &a_task));
+        }
+        work(0, &queues, &a_task);
+
+        for (size_t n = 0; n < threads.size(); n++)
+        {
+            threads[n].join();
+        }
+    }
+
+private:
+
+    struct Queue
+    {
+        std::mutex m_mutex;
+        std::deque<int> m_tasks;
+    };
+
+    template <typename TASK>
+    void work(int a_worker, std::vector<Queue>* a_queues, TASK* a_task)
+    {
+        int task;
+        while (takeOwn(a_worker, *a_queues, task) || steal(a_worker, *a_queues, task))
+        {
+            (*a_task)(task, a_worker);
+        }
+    }
+
+    bool takeOwn(int a_worker, std::vector<Queue>& a_queues, int& a_task)
+    {
+        Queue& queue = a_queues[a_worker];
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        if (queue.m_tasks.empty()) { return false; }
+
+        a_task = queue.m_tasks.front();
+        queue.m_tasks.pop_front();
+        return true;
+    }
+
+    // tasks never create tasks, so all queues empty means the run is finished
+    bool steal(int a_worker, std::vector<Queue>& a_queues, int& a_task)
+    {
+        for (int n = 1; n < m_numThreads; n++)
+        {
+            Queue& victim = a_queues[(a_worker + n) % m_numThreads];
+            std::lock_guard<std::mutex> lock(victim.m_mutex);
+            if (victim.m_tasks.empty()) { continue; }
+
+            a_task = victim.m_tasks.back();
+            victim.m_tasks.pop_back();
+            m_stolen++;
+            return true;
+        }
+        return false;
+    }
+
+    int m_numThreads;
+    std::atomic<unsigned long long> m_stolen;
+};
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------